@@ -6,12 +6,20 @@
 #define FLASHGC_ALGORUNNER_H
 
 #include "MyRand.h"
+#include "WorkloadStream.h"
+#include "TraceFile.h"
 #include "FTL.hpp"
-#include "ListItem.h"
+#include "Geometry.h"
+#include "SteadyStateDetector.h"
+#include "Statistics.h"
+#include "LocationIndex.h"
+#include "Profiler.h"
 #include "Auxilaries.h"
 #include <map>
 #include <vector>
 #include <algorithm>
+#include <functional>
+#include <queue>
 #include <cmath>
 #include <unistd.h>
 
@@ -27,6 +35,31 @@ public:
     /* parameters for Hot/Cold memory simulation */
     int hot_pages_percentage;
     double hot_pages_probability;
+    /* binary trace file to replay (TRACE distribution) */
+    std::string trace_path;
+    /* steady state snapshot files: if load_snapshot is set the steady state is loaded from it instead of
+     * running the warmup, if save_snapshot is set the steady state is saved to it after the warmup */
+    std::string load_snapshot;
+    std::string save_snapshot;
+    /* number of warmup writes. 0 runs the warmup until SteadyStateDetector declares steady state */
+    unsigned long long warmup_writes;
+    /* generator of the uniform/hot-cold writing sequence, and the number of threads generating it (Philox only,
+     * 0 or 1 generates on the stream's own thread) */
+    SequenceGenerator sequence_generator;
+    int generation_threads;
+    /* stop the measurement once the 95% confidence interval of the WA is within +-ci_target of the mean
+     * (relative, e.g 0.01). 0 measures the whole writing sequence */
+    double ci_target;
+    /* time series file (see TimeSeriesRecorder.h), empty for none, and the number of erases between samples
+     * (0 samples every erase) */
+    std::string series_path;
+    unsigned long long series_interval;
+    /* victim candidates of greedy_lookahead: the full blocks of V[Y]..V[Y + candidate_depth], at most
+     * candidate_blocks of them (0 - no limit), scored on score_threads threads (0 or 1 scores on the simulation
+     * thread) */
+    int candidate_depth;
+    int candidate_blocks;
+    int score_threads;
 };
 
 class AlgoRunner{
@@ -36,27 +69,32 @@ public:
     /* Algorithm's type which user would like to simulate */
     Algorithm algo;
 
+    /* seed of the simulation. the runner owns its random number generator, so every instance is reproducible
+     * from its seed and instances on different threads are independent */
+    unsigned long long seed;
+    KissGenerator kiss_generator;
+
     /* the writing sequence that is given as an input to all Look Ahead algorithms in this class.
-     * the writing sequence is an array of integers, where writing_sequence[i] is the logical page
-     * number that will be written in the ith place (i.e the i+1 write since we start from 0).
+     * writing_sequence->at(i) is the logical page number that will be written in the ith place (i.e the i+1
+     * write since we start from 0). the sequence is streamed: only the positions from the current write up to
+     * the lookahead horizon are kept in memory.
      */
-    unsigned int* writing_sequence;
+    WorkloadStream* writing_sequence;
 
-    /* number of pages in writing sequence. This parameter can be adjusted to be a window of known writes, but
-     * this feature may require some more adjustments
-     * In the current implementation we use the global NUMBER_OF_PAGES macro, but this is bad practice for sure
-     * if we wish to scale up in any way.. in that case we should switch and use this member element */
-    unsigned long long number_of_pages;
+    /* geometry of the simulated device (T, U, Z, page size and N) */
+    Geometry geometry;
 
-    /* location list is a hash table that maps a logical page number to a ListItem that contains a list of indexes
-     * in the writing sequence such that for page i and each index j in the location list matching that page i it
-     * holds that writing_sequence[j] == i
-     */
-    map<unsigned int,ListItem>* logical_pages_location_map;
+    /* number of pages in writing sequence (N). This parameter can be adjusted to be a window of known writes, but
+     * this feature may require some more adjustments */
+    unsigned long long number_of_pages;
 
-    /* writing page_dist represents the data distribution type - uniform distribution or Hot/Cold distribution */
+    /* writing page_dist represents the data distribution type - uniform distribution, Hot/Cold distribution or
+     * a replayed trace */
     PageDistribution page_dist;
 
+    /* the mapped trace file for the TRACE distribution (nullptr otherwise) */
+    MappedTrace* trace;
+
     /* class which contains:
      * HOT_COLD parameters (hot pages percentage and probability)
      * window size
@@ -66,9 +104,26 @@ public:
 
     WindowSizeFlag window_size_flag;
 
+    /* next write index over writing_sequence, used by the lookahead algorithms (nullptr for greedy).
+     * the index also answers "where is this page written next" queries, in place of a full locations map.
+     */
+    LookaheadIndex* lookahead_index;
+
+    /* locations of every page in the current window, used by the writing assignment (nullptr until first used) */
+    LocationIndex* location_index;
+
     /* FTL memory layout object */
     FTL* ftl;
 
+    /* lockstep runs (runLockstepSimulation): the algorithms that run side by side and the FTL of each one.
+     * lockstep_ftls[0] is ftl, the others are forks of it made once the steady state is reached.
+     */
+    vector<Algorithm> lockstep_algorithms;
+    vector<FTL*> lockstep_ftls;
+
+    /* batch means of the WA of the measured FTL (one per lockstep lane), see Statistics.h */
+    vector<BatchMeans> batch_means;
+
     /* data to write in each page. As mentioned below, this data is generated randomly and is the same across all
      * pages. for the sake if this simulator this is fine, but of course you can change this to contain some
      * meaningful data
@@ -76,29 +131,36 @@ public:
     char* data;
 
     bool reach_steady_state;
-    bool print_mode;
+
+    /* records the time series of ftl if user_parameters.series_path is set, nullptr otherwise */
+    TimeSeriesRecorder* recorder;
+
+    /* scores the victim candidates of the FTLs if user_parameters.score_threads > 1, nullptr otherwise */
+    ThreadPool* score_pool;
+
+    /* if turned off the runner prints nothing (used when many simulations run side by side) */
+    bool verbose;
 
     ////// C'tors & D'tor:  //////
 
-    /* C'tor for scheduledGC object.
-     * NOTE: throughout the whole class implementation we use the global macros NUMBER_OF_PAGES, PAGES_PER_BLOCK, etc.
-     * I guess that best practice is not to use the global macros, and instead pass relevant parameters to the class c'tor (as we do with number_of_pages).
-     * but for now this is fine. If you were to use this class file and copy it to their your personal use,
-     * you should note that some changes may be needed to use only the parameters passed to the class
-     * c'tor (and this is better coding practice).
+    /* C'tor for scheduledGC object. the hot/cold parameters, window size and number of generations are read from
+     * the user, the rest of user_parameters (trace, snapshots, warmup, etc.) is taken as given.
+     * all the memory parameters are taken from the geometry passed to the c'tor, so several runners with
+     * different geometries can live (and run concurrently) in one process.
      */
-    AlgoRunner(long long number_of_pages, PageDistribution page_dist, Algorithm algo, WindowSizeFlag window_size_flag) :
-                                                                        algo(algo), number_of_pages(number_of_pages), page_dist(page_dist), window_size_flag(window_size_flag), ftl(nullptr),
-                                                                        data(nullptr), reach_steady_state(true), print_mode(false){
-        /* generates writing sequence for uniform or hot-cold distribution */
-        generateWritingSequence();
+    AlgoRunner(const Geometry& geometry, PageDistribution page_dist, Algorithm algo, WindowSizeFlag window_size_flag,
+               const UserParameters& user_parameters, unsigned long long seed) :
+                                                                        algo(algo), seed(seed), kiss_generator(seed), writing_sequence(nullptr), geometry(geometry), number_of_pages(geometry.number_of_pages), page_dist(page_dist), trace(nullptr), user_parameters(user_parameters), window_size_flag(window_size_flag), lookahead_index(nullptr), location_index(nullptr), ftl(nullptr),
+                                                                        data(nullptr), reach_steady_state(true), recorder(nullptr), score_pool(nullptr), verbose(true){
+        if (page_dist == HOT_COLD){
+            getHotColdParamsFromUser();
+        }
 
-        /* construct a mapping between a logical page number to a ListItem corresponding the logical page.
-        * each ListItem for logical page i contains the list of locations in the writing sequence where
-        * the page i is written. each ListItem contains a list of locations sorted in an ascending order.
-        */
+        /* starts streaming the writing sequence for uniform or hot-cold distribution. generation runs on its own
+         * thread and overlaps with the rest of the simulation.
+         */
+        generateWritingSequence();
 
-        logical_pages_location_map = createLocationsMap(0,NUMBER_OF_PAGES);
         initializeFTL();
 
         /* get extra parameters:
@@ -108,11 +170,39 @@ public:
         getUserParams();
     }
 
+    /* C'tor for non-interactive runs (e.g the sweep engine). all the extra parameters are taken from
+     * user_parameters instead of being read from the user: a window size of N (or 0) means no window,
+     * and 0 generations selects the number of generations with the overloading factor heuristic.
+     */
+    AlgoRunner(const Geometry& geometry, PageDistribution page_dist, Algorithm algo, const UserParameters& user_parameters,
+               unsigned long long seed, bool verbose) :
+               algo(algo), seed(seed), kiss_generator(seed), writing_sequence(nullptr), geometry(geometry), number_of_pages(geometry.number_of_pages),
+               page_dist(page_dist), trace(nullptr), user_parameters(user_parameters),
+               window_size_flag(user_parameters.window_size < geometry.number_of_pages ? WINDOW_SIZE_ON : WINDOW_SIZE_OFF),
+               lookahead_index(nullptr), location_index(nullptr), ftl(nullptr), data(nullptr), reach_steady_state(true), recorder(nullptr),
+               score_pool(nullptr), verbose(verbose){
+        generateWritingSequence();
+        initializeFTL();
+        if (this->user_parameters.window_size == 0 || this->user_parameters.window_size > number_of_pages){
+            this->user_parameters.window_size = number_of_pages;
+        }
+        if (algo == GENERATIONAL && this->user_parameters.number_of_generations == 0){
+            this->user_parameters.number_of_generations = ftl->optimized_params.second;
+        }
+    }
+
     ~AlgoRunner() {
-        delete [] writing_sequence;
-        delete [] logical_pages_location_map;
+        for (unsigned int i = 1; i < lockstep_ftls.size(); i++) {
+            delete lockstep_ftls[i];
+        }
+        delete lookahead_index;
+        delete location_index;
+        delete writing_sequence;
+        delete trace;
         delete [] data;
+        delete recorder;
         delete ftl;
+        delete score_pool;
     }
 
 
@@ -126,14 +216,41 @@ public:
      * data itself. for this reason we populate all pages with the same value.
      */
     void initializeFTL(){
-        ftl = new FTL();
+        ftl = new FTL(geometry);
+
+        /* the lookahead algorithms need to know when each page is overwritten next */
+        if (algo != GREEDY){
+            lookahead_index = new LookaheadIndex(writing_sequence, number_of_pages, geometry.logicalPages(),
+                                                 getLookaheadHorizon());
+            ftl->setLookaheadIndex(lookahead_index);
+        }
+
+        /* the victim candidates of greedy_lookahead. the lockstep forks share them and the score pool (the lanes run
+         * one after the other)
+         */
+        ftl->candidate_depth = user_parameters.candidate_depth;
+        ftl->candidate_blocks = user_parameters.candidate_blocks;
+        if (user_parameters.score_threads > 1){
+            score_pool = new ThreadPool(user_parameters.score_threads);
+            ftl->setScorePool(score_pool);
+        }
+
+        /* record the time series of the run, warmup included */
+        if (!user_parameters.series_path.empty()){
+            recorder = TimeSeriesRecorder::open(user_parameters.series_path, geometry.pages_per_block,
+                                                user_parameters.series_interval);
+            if (!recorder){
+                exit(-1);
+            }
+            ftl->recorder = recorder;
+        }
 
         /* initialize data page. will remain the same */
-        data = new char[PAGE_SIZE];
+        data = new char[geometry.page_size];
 
        /* fill pages with random data */
-        for (int j = 0; j < PAGE_SIZE; j++) {
-            data[j] = KISS() % 256;
+        for (int j = 0; j < geometry.page_size; j++) {
+            data[j] = kiss_generator() % 256;
         }
     }
 
@@ -141,129 +258,213 @@ public:
         reach_steady_state = state;
     }
 
-    void setPrintMode(bool mode){
-        print_mode = mode;
-        ftl->print_mode = mode;
-    }
-
     void reachSteadyState(){
         unsigned int logical_page_to_write;
-        data = new char[PAGE_SIZE];
 
-        /* fill pages with random data */
-        for (int j = 0; j < PAGE_SIZE; j++) {
-            data[j] = KISS() % 256;
+        if (!user_parameters.load_snapshot.empty()){
+            if (!ftl->loadSnapshot(user_parameters.load_snapshot.c_str())){
+                cerr << "Error! can not load steady state snapshot " << user_parameters.load_snapshot
+                     << " (missing file, or saved with a different T, U, Z)." << endl;
+                exit(-1);
+            }
+            if (verbose){
+                cout << "Steady State (" << ftl->logicalPageWritesSteady << " warmup writes) loaded from "
+                     << user_parameters.load_snapshot << "..." << endl;
+                cout << endl;
+            }
+            return;
         }
 
         /* reach steady state */
-        cout<<"Reaching Steady State..."<<endl;
-        if (print_mode){
-            ftl->printHeader();
-        }
-        /* you can adjust this */
-        for (int i = 0; i < 1000000; i++) {
-            logical_page_to_write = KISS() % (LOGICAL_BLOCK_NUMBER * PAGES_PER_BLOCK);
+        if (verbose){
+            cout<<"Reaching Steady State..."<<endl;
+        }
+        /* a fixed number of writes if the user asked for one, otherwise until the detector sees the write
+         * amplification and the V histogram settle */
+        SteadyStateDetector detector(ftl);
+        unsigned long long warmup_writes = user_parameters.warmup_writes;
+        for (unsigned long long i = 0; warmup_writes ? i < warmup_writes : !detector.converged(); i++) {
+            logical_page_to_write = kiss_generator() % geometry.logicalPages();
             ftl->write(data,logical_page_to_write,GREEDY);
+            detector.recordWrite();
         }
         ftl->erases_steady = ftl->erases;
         ftl->logicalPageWritesSteady = ftl->logicalPageWrites;
         ftl->physicalPageWritesSteady = ftl->physicalPageWrites;
-        cout<<"Steady State Reached..."<<endl;
-        cout << endl;
+        if (!user_parameters.save_snapshot.empty() && !ftl->saveSnapshot(user_parameters.save_snapshot.c_str())){
+            cerr << "Error! can not save steady state snapshot " << user_parameters.save_snapshot << "." << endl;
+            exit(-1);
+        }
+        if (verbose){
+            if (!user_parameters.warmup_writes && !detector.stable){
+                cout << "Steady State not detected after " << ftl->logicalPageWrites << " writes, "
+                     << "stopping the warmup." << endl;
+            }
+            cout<<"Steady State Reached after "<<ftl->logicalPageWrites<<" warmup writes..."<<endl;
+            cout << endl;
+        }
     }
 
-    /* get the number of unique logical pages in writing_sequence */
-    unsigned int getLocationListSize(unsigned long long base_index, unsigned int window_size) const{
-        set<int> logical_pages_in_window;
-        for (unsigned long long i = base_index; i < base_index + window_size && i < NUMBER_OF_PAGES ; ++i) {
-            logical_pages_in_window.insert(writing_sequence[i]); // will not add duplicates
+    /* number of future writes the algorithm needs to see. the block score looks T*Z writes ahead, which also
+     * covers the generation intervals of the generational algorithm and the writing assignment windows.
+     */
+    unsigned long long getLookaheadHorizon() const{
+        if (algo == GREEDY){
+            return 0;
         }
-        return logical_pages_in_window.size();
+        return geometry.physicalPages();
     }
 
     void generateWritingSequence(){
-        /* generate a writing sequence according to the desired writing page_dist */
-        if (page_dist == UNIFORM){
-            writing_sequence = generateUniformlyDistributedWriteSequence();
+        /* the KISS stream is forked for every page_dist and sequence generator (a trace or philox source ignores
+         * the fork), so the data and the warmup always draw the same numbers */
+        KissGenerator sequence_kiss_generator = kiss_generator.fork();
+        if (page_dist == TRACE){
+            replayTrace();
+            return;
         }
-        else {
-            if(output_file){
-                dup2(fd_stdout, 1);
-            }
-            cout<<"Please enter parameters for Hot/Cold memory simulation."<<endl<<"Enter the hot page percentage out of all logical pages in memory (0-100): "<<endl;
-            cin >> user_parameters.hot_pages_percentage;
-            if(user_parameters.hot_pages_percentage < 0 or user_parameters.hot_pages_percentage > 100){
-                cerr<<"Error! Hot pages percentage must be in 0-100 range. Use --help for more information."<<endl;
-                exit(-1);
+
+        /* generate a writing sequence according to the desired writing page_dist */
+        WritingSequenceSource* source;
+        if (user_parameters.sequence_generator == PHILOX_GENERATOR){
+            if (page_dist == UNIFORM){
+                source = new PhiloxUniformSequenceSource(geometry.logicalPages(), seed,
+                                                         user_parameters.generation_threads);
             }
-            cout<<"Enter the probability for hot pages (0-1): "<<endl;
-            cin >> user_parameters.hot_pages_probability;
-            if(user_parameters.hot_pages_probability < 0 or user_parameters.hot_pages_probability > 1){
-                cerr<<"Error! Hot pages probability must be in 0-1 range. Use --help for more information."<<endl;
-                exit(-1);
+            else {
+                source = new PhiloxHotColdSequenceSource(geometry.logicalPages(), user_parameters.hot_pages_percentage,
+                                                         user_parameters.hot_pages_probability, seed,
+                                                         user_parameters.generation_threads);
             }
-            if(output_file)
-                freopen(output_file, "a", stdout);
-            writing_sequence = generateHotColdWriteSequence(user_parameters.hot_pages_percentage, user_parameters.hot_pages_probability);
+        }
+        else if (page_dist == UNIFORM){
+            source = new UniformSequenceSource(geometry.logicalPages(), sequence_kiss_generator);
+        }
+        else {
+            source = new HotColdSequenceSource(geometry.logicalPages(), user_parameters.hot_pages_percentage,
+                                               user_parameters.hot_pages_probability, sequence_kiss_generator);
+        }
+        writing_sequence = new WorkloadStream(source, number_of_pages, getLookaheadHorizon());
+    }
+
+    /* use the writes of a binary trace file as the writing sequence. the simulation replays the first N writes
+     * of the trace (all of them if N is 0 or larger than the trace). a trace without op types is read in place
+     * from the mapped file, a trace with op types is streamed without its read entries.
+     */
+    void replayTrace(){
+        trace = new MappedTrace(user_parameters.trace_path);
+        if (trace->numberOfLogicalPages() > geometry.logicalPages()){
+            cerr << "Error! the trace addresses " << trace->numberOfLogicalPages() << " logical pages but the device has "
+                 << geometry.logicalPages() << " (U*Z). Use a larger U or convert the trace with --compact." << endl;
+            exit(-1);
+        }
+        if (number_of_pages == 0 || number_of_pages > trace->numberOfWrites()){
+            number_of_pages = trace->numberOfWrites();
+            geometry.number_of_pages = number_of_pages;
+        }
+        if (verbose){
+            cout << "Replaying " << number_of_pages << " writes of trace " << trace->path << "." << endl;
+        }
+        if (trace->hasOps()){
+            writing_sequence = new WorkloadStream(new TraceSequenceSource(trace), number_of_pages, getLookaheadHorizon());
+        }
+        else {
+            writing_sequence = new WorkloadStream(trace->lpns, number_of_pages);
         }
     }
 
+    void getHotColdParamsFromUser(){
+        if(output_file){
+            dup2(fd_stdout, 1);
+        }
+        cout<<"Please enter parameters for Hot/Cold memory simulation."<<endl<<"Enter the hot page percentage out of all logical pages in memory (0-100): "<<endl;
+        cin >> user_parameters.hot_pages_percentage;
+        if(user_parameters.hot_pages_percentage < 0 or user_parameters.hot_pages_percentage > 100){
+            cerr<<"Error! Hot pages percentage must be in 0-100 range. Use --help for more information."<<endl;
+            exit(-1);
+        }
+        cout<<"Enter the probability for hot pages (0-1): "<<endl;
+        cin >> user_parameters.hot_pages_probability;
+        if(user_parameters.hot_pages_probability < 0 or user_parameters.hot_pages_probability > 1){
+            cerr<<"Error! Hot pages probability must be in 0-1 range. Use --help for more information."<<endl;
+            exit(-1);
+        }
+        if(output_file)
+            freopen(output_file, "a", stdout);
+    }
+
     void getUserParams(){
         if(algo != GREEDY) {
             if (window_size_flag == WINDOW_SIZE_ON)
                 getWindowSizeFromUser();
             if (window_size_flag == WINDOW_SIZE_OFF)
-                user_parameters.window_size = NUMBER_OF_PAGES;
+                user_parameters.window_size = number_of_pages;
         }
         if(algo == GENERATIONAL)
             getNumOfGenerationsFromUser();
     }
 
-    map<unsigned int,ListItem>* createLocationsMap(unsigned long long base_index, unsigned int window_size) const{
-        unsigned int location_list_size = getLocationListSize(base_index,window_size);
-        map<unsigned int,ListItem>* locations_list = new map<unsigned int,ListItem>[location_list_size];
-        for (unsigned long long i = base_index; i < base_index + window_size && i < NUMBER_OF_PAGES; ++i) {
-            auto iterator = locations_list->find(writing_sequence[i]);
-            if (iterator == locations_list->end()){
-                locations_list->insert({writing_sequence[i],ListItem(writing_sequence[i],i)});
-            }
-            else {
-                iterator->second.addLocation(i);
-            }
+    /* index the locations of every logical page of the window. the index (and its memory) is reused from window
+     * to window, so it is only valid until the next call
+     */
+    LocationIndex* buildLocationIndex(unsigned long long base_index, unsigned int window_size){
+        PROFILE_SCOPE(PROFILE_LOCATION_INDEX);
+        if (!location_index){
+            location_index = new LocationIndex(geometry.logicalPages());
         }
-        return locations_list;
+        location_index->build(writing_sequence, base_index, window_size, number_of_pages);
+        return location_index;
     }
 
     void runGreedySimulation(Algorithm algo, unsigned long long window_size = 0) {
         if (reach_steady_state){
             reachSteadyState();
         }
-        for (unsigned long long i = 0; i < window_size; i++) {
-            ftl->write(data,writing_sequence[i], algo, writing_sequence, i);
+        startMeasurement();
+        for (unsigned long long i = 0; i < window_size && !measurementConverged(); i++) {
+            lookahead_index->extendWindow(i);
+            ftl->write(data,writing_sequence->at(i), algo, i);
+            lookahead_index->advance(i);
+            writing_sequence->release(i + 1);
         }
         /* After running LOOK_AHEAD/GENERATIONAL algorithm, now we should run
          * GREEDY for the rest of writing sequence */
-        for (unsigned long long i = window_size; i < NUMBER_OF_PAGES; i++) {
-            ftl->write(data,writing_sequence[i],GREEDY, writing_sequence, i);
+        for (unsigned long long i = window_size; i < number_of_pages && !measurementConverged(); i++) {
+            ftl->write(data,writing_sequence->at(i),GREEDY, i);
+            writing_sequence->release(i + 1);
         }
     }
 
     void runSimulation(Algorithm algorithm){
         switch (algorithm) {
             case GREEDY:
-                cout<<"Starting Greedy Algorithm simulation..."<<endl;
+                if (verbose){
+                    cout<<"Starting Greedy Algorithm simulation..."<<endl;
+                }
                 runGreedySimulation(GREEDY);
                 break;
             case GREEDY_LOOKAHEAD:
-                cout<<"Starting Greedy LookAhead Algorithm simulation..."<<endl;
+                if (verbose){
+                    cout<<"Starting Greedy LookAhead Algorithm simulation..."<<endl;
+                }
                 runGreedySimulation(GREEDY_LOOKAHEAD, user_parameters.window_size);
                 break;
+            case ORACLE:
+                if (verbose){
+                    cout<<"Starting Oracle Algorithm simulation..."<<endl;
+                }
+                runGreedySimulation(ORACLE, user_parameters.window_size);
+                break;
             case GENERATIONAL:
-                cout<<"Starting Generational Algorithm simulation..."<<endl;
+                if (verbose){
+                    cout<<"Starting Generational Algorithm simulation..."<<endl;
+                }
                 runGenerationalSimulation(user_parameters.number_of_generations, user_parameters.window_size);
                 break;
             case WRITING_ASSIGNMENT:
-                cout<<"Starting Writing Assignment Algorithm simulation..."<<endl;
+                if (verbose){
+                    cout<<"Starting Writing Assignment Algorithm simulation..."<<endl;
+                }
                 runWritingAssignmentSimulation();
                 break;
             default:
@@ -273,36 +474,187 @@ public:
     }
 
     void printSimulationResults() const{
-        int erases = ftl->erases-ftl->erases_steady;
-        int logical_page_writes = ftl->logicalPageWrites-ftl->logicalPageWritesSteady;
-        int physical_page_writes = ftl->physicalPageWrites-ftl->physicalPageWritesSteady;
+        if (lockstep_algorithms.empty()){
+            cout << "Simulation Results:" << endl;
+            printFTLResults(ftl);
+            printConfidenceInterval(0);
+            return;
+        }
+        for (unsigned int i = 0; i < lockstep_algorithms.size(); i++) {
+            cout << "Simulation Results (" << algoEnumToString(lockstep_algorithms[i]) << "):" << endl;
+            printFTLResults(lockstep_ftls[i]);
+            printConfidenceInterval(i);
+        }
+    }
+
+    void printConfidenceInterval(unsigned int lane) const{
+        if (lane >= batch_means.size() || batch_means[lane].batches < 2){
+            return;
+        }
+        const BatchMeans& lane_batch_means = batch_means[lane];
+        cout << "WA 95% confidence interval: " << lane_batch_means.mean() << " +- " << lane_batch_means.halfWidth()
+             << " (" << lane_batch_means.batches << " batches of " << lane_batch_means.batch_length << " writes";
+        if (user_parameters.ci_target > 0){
+            cout << (lane_batch_means.reached(user_parameters.ci_target) ? ", target reached" : ", target not reached");
+        }
+        cout << ")" << endl;
+    }
+
+    /* the FTLs whose WA is measured: ftl, or every lane of a lockstep run */
+    unsigned int measuredFTLs() const{
+        return lockstep_ftls.empty() ? 1 : lockstep_ftls.size();
+    }
+
+    const FTL* measuredFTL(unsigned int lane) const{
+        return lockstep_ftls.empty() ? ftl : lockstep_ftls[lane];
+    }
+
+    /* start the batch means of the measurement phase. a batch is one device worth of writes (T*Z, at least
+     * CI_MIN_BATCH_LENGTH), long enough for the batch WAs to be nearly independent.
+     */
+    void startMeasurement(){
+        unsigned long long batch_length = std::max((unsigned long long)geometry.physicalPages(), CI_MIN_BATCH_LENGTH);
+        batch_means.assign(measuredFTLs(), BatchMeans(batch_length));
+    }
+
+    /* close the batches completed by the writes so far. returns true once the measurement can stop: early
+     * termination is on (ci_target) and the interval of every measured FTL reached the target.
+     */
+    bool measurementConverged(){
+        bool converged = user_parameters.ci_target > 0;
+        for (unsigned int lane = 0; lane < batch_means.size(); lane++) {
+            const FTL* measured = measuredFTL(lane);
+            batch_means[lane].record(measured->logicalPageWrites - measured->logicalPageWritesSteady,
+                                     measured->physicalPageWrites - measured->physicalPageWritesSteady);
+            converged = converged && batch_means[lane].reached(user_parameters.ci_target);
+        }
+        return converged;
+    }
+
+    static void printFTLResults(const FTL* ftl){
+        unsigned long long erases = ftl->erases-ftl->erases_steady;
+        unsigned long long logical_page_writes = ftl->logicalPageWrites-ftl->logicalPageWritesSteady;
+        unsigned long long physical_page_writes = ftl->physicalPageWrites-ftl->physicalPageWritesSteady;
         double wa = (double)physical_page_writes/logical_page_writes;
-        //double erasure_factor = erases/(NUMBER_OF_PAGES /(double)PAGES_PER_BLOCK);
-        cout << "Simulation Results:" << endl << "Number of erases: " << erases
-        << ". Write Amplification: " << wa << endl;
+        //double erasure_factor = erases/(number_of_pages /(double)geometry.pages_per_block);
+        cout << "Number of erases: " << erases << ". Write Amplification: " << wa << endl;
+    }
+
+    /* the algorithm a runner for a lockstep run of 'algorithms' should be built with: it decides which
+     * parameters are needed (window size, number of generations) and whether the lookahead index is built.
+     */
+    static Algorithm lockstepAlgorithm(const vector<Algorithm>& algorithms){
+        Algorithm res = GREEDY;
+        for (Algorithm algorithm : algorithms) {
+            if (algorithm == GENERATIONAL || ((algorithm == GREEDY_LOOKAHEAD || algorithm == ORACLE) && res == GREEDY)){
+                res = algorithm;
+            }
+        }
+        return res;
+    }
+
+    /* run several algorithms side by side on one writing sequence: the FTL is forked once the steady state is
+     * reached, and every write of the sequence is applied to all forks before moving on to the next one. all
+     * the algorithms start from the identical device state and share the sequence and its lookahead index.
+     * the runner must be built with lockstepAlgorithm(algorithms). writing_assignment is not supported since
+     * it writes whole windows at a time.
+     */
+    void runLockstepSimulation(const vector<Algorithm>& algorithms){
+        assert(algo == lockstepAlgorithm(algorithms));
+        if (reach_steady_state){
+            reachSteadyState();
+        }
+        lockstep_algorithms = algorithms;
+        lockstep_ftls.push_back(ftl);
+        for (unsigned int i = 1; i < algorithms.size(); i++) {
+            lockstep_ftls.push_back(ftl->clone());
+        }
+        int num_of_gens = user_parameters.number_of_generations;
+        for (unsigned int k = 0; k < algorithms.size(); k++) {
+            if (algorithms[k] == GENERATIONAL){
+                for (int j = 0; j < num_of_gens; ++j) {
+                    lockstep_ftls[k]->gen_blocks.insert({j, nullptr});
+                }
+            }
+        }
+        startMeasurement();
+        if (verbose){
+            cout << "Starting Lockstep simulation of " << algorithms.size() << " algorithms..." << endl;
+        }
+
+        unsigned long long window_size = algo == GREEDY ? 0 : user_parameters.window_size;
+        for (unsigned long long i = 0; i < number_of_pages && !measurementConverged(); i++) {
+            if (i == window_size){
+                /* end of the window: the generational blocks go back to the free list, as in
+                 * runGenerationalSimulation */
+                for (unsigned int k = 0; k < algorithms.size(); k++) {
+                    for (auto& gen_block : lockstep_ftls[k]->gen_blocks) {
+                        if (gen_block.second){
+                            lockstep_ftls[k]->freeList.push_back(gen_block.second);
+                        }
+                    }
+                    lockstep_ftls[k]->gen_blocks.clear();
+                }
+            }
+            bool in_window = i < window_size;
+            if (in_window){
+                lookahead_index->extendWindow(i);
+            }
+            unsigned int lpn = writing_sequence->at(i);
+            int generation = -1;
+            for (unsigned int k = 0; k < algorithms.size(); k++) {
+                if (!in_window || algorithms[k] == GREEDY){
+                    lockstep_ftls[k]->write(data, lpn, GREEDY, i);
+                }
+                else if (algorithms[k] == GREEDY_LOOKAHEAD || algorithms[k] == ORACLE){
+                    lockstep_ftls[k]->write(data, lpn, algorithms[k], i);
+                }
+                else {
+                    if (generation < 0){
+                        generation = getGeneration(i, num_of_gens);
+                    }
+                    lockstep_ftls[k]->writeGenerational(data, lpn, generation, i);
+                }
+            }
+            if (in_window){
+                lookahead_index->advance(i);
+            }
+            writing_sequence->release(i + 1);
+        }
     }
 
     void runWritingAssignmentSimulation(){
         if (reach_steady_state){
             reachSteadyState();
         }
+        startMeasurement();
+        /* the future writes known to the writing assignment end at the user window (N when the window is off) */
+        unsigned long long assignment_end = std::min(user_parameters.window_size, number_of_pages);
         unsigned long long base_index = 0;
-        unsigned int window_size = getWindowSize();
-        while (base_index < NUMBER_OF_PAGES){
+        /* the writing assignment is planned a whole window at a time, so the measurement stops on window bounds */
+        while (base_index < assignment_end && !measurementConverged()){
+            unsigned int window_size = std::min((unsigned long long)getWindowSize(), assignment_end - base_index);
+            lookahead_index->extendWindow(base_index);
             vector<pair<unsigned int,int>> writing_assignment = getWritingAssignment(base_index,window_size);
-            for (unsigned long long i = 0; i < writing_assignment.size() && i < NUMBER_OF_PAGES; i++) {
+            for (unsigned long long i = 0; i < writing_assignment.size() && base_index + i < number_of_pages; i++) {
                 ftl->writeToBlock(data, writing_assignment[i].first, writing_assignment[i].second);
+                lookahead_index->advance(base_index + i);
+                writing_sequence->release(base_index + i + 1);
             }
             base_index += window_size;
-            window_size = getWindowSize();
+        }
+        /* After the writing assignment window, now we should run GREEDY for the rest of writing sequence */
+        for (unsigned long long i = base_index; i < number_of_pages && !measurementConverged(); i++) {
+            ftl->write(data,writing_sequence->at(i),GREEDY, i);
+            writing_sequence->release(i + 1);
         }
     }
 
     unsigned int getWindowSize() const{
         if (page_dist == UNIFORM){
-            return (PHYSICAL_BLOCK_NUMBER * PAGES_PER_BLOCK) - ftl->windowSizeAux();
+            return geometry.physicalPages() - ftl->windowSizeAux();
         }
-        return (PHYSICAL_BLOCK_NUMBER * PAGES_PER_BLOCK) - ftl->getNumberOfValidPages();
+        return geometry.physicalPages() - ftl->getNumberOfValidPages();
     }
 
     void getWindowSizeFromUser(){
@@ -311,7 +663,7 @@ public:
         }
         cout << "Enter Window Size:"<<endl;
         cin >> user_parameters.window_size;
-        if(user_parameters.window_size > NUMBER_OF_PAGES){
+        if(user_parameters.window_size > number_of_pages){
             cerr<<"Error! Window size is bigger than Number Of Pages."<<endl;
             printHelp();
             exit(-1);
@@ -330,7 +682,7 @@ public:
         cin >> user_parameters.number_of_generations;
         if(output_file)
             freopen(output_file, "a", stdout);
-        if (user_parameters.number_of_generations > PHYSICAL_BLOCK_NUMBER - LOGICAL_BLOCK_NUMBER){
+        if (user_parameters.number_of_generations > geometry.physical_blocks - geometry.logical_blocks){
             cerr << "Error! number of generations must be at least T-U. Use --help for more information." << endl;
             exit(-1);
         }
@@ -360,14 +712,17 @@ public:
         ftl->printMemoryLayout();
         unsigned long long base_index = 0;
         unsigned int window_size = getWindowSize();
-        while (base_index < NUMBER_OF_PAGES){
+        while (base_index < number_of_pages){
             cout<<"memory before window writes:"<<endl;
             ftl->printMemoryLayout();
             cout<<"window size: "<<window_size<<endl;
+            lookahead_index->extendWindow(base_index);
             vector<pair<unsigned int,int>> writing_assignment = getWritingAssignment(base_index,window_size);
             printAssignment(writing_assignment);
-            for (unsigned long long i = 0; i < writing_assignment.size() && i < NUMBER_OF_PAGES; i++) {
+            for (unsigned long long i = 0; i < writing_assignment.size() && base_index + i < number_of_pages; i++) {
                 ftl->writeToBlock(data, writing_assignment[i].first, writing_assignment[i].second);
+                lookahead_index->advance(base_index + i);
+                writing_sequence->release(base_index + i + 1);
             }
             cout<<"memory after window writes:"<<endl;
             ftl->printMemoryLayout();
@@ -387,17 +742,16 @@ public:
         /* construct a result vector, containing pairs of (logical_page_to_write,physical_block_to_write_to) */
         vector<pair<unsigned int,int>> res(window_size);
         int j = 0;
-        for (unsigned long long i = base_index; i < base_index + window_size && i < NUMBER_OF_PAGES ; i++){
-            res[j].first = writing_sequence[i];
+        for (unsigned long long i = base_index; i < base_index + window_size && i < number_of_pages ; i++){
+            res[j].first = writing_sequence->at(i);
             res[j].second = TBD;
             j++;
         }
 
-        /* construct a mapping between a logical page number to a ListItem corresponding the logical page.
-         * each ListItem for logical page i contains the list of locations in the writing sequence where
-         * the page i is written. each ListItem should contain a list of locations sorted in an ascending order.
+        /* index the locations in the writing sequence where every logical page of the window is written, in
+         * ascending order.
          */
-        map<unsigned int,ListItem>* locations_list = createLocationsMap(base_index, window_size);
+        LocationIndex* locations = buildLocationIndex(base_index, window_size);
 
         /* get an ordered list of block numbers to assign writes to. Blocks are ordered by block score function
          * in ascending order.
@@ -410,35 +764,38 @@ public:
          * i.e marked as INVALID. for blocks[1] we assign pages that are the SECOND ONES
          * to be overwritten, etc.
          */
-        assignWritesToBlocks(locations_list, &res, blocks, base_index);
+        assignWritesToBlocks(locations, &res, blocks, base_index);
 
         /* the final output contains the block number for each page in the window.
          * this is the physical page that we will write the page to.
          */
-
-        delete [] locations_list;
         return res;
 
     }
 
     vector<int> getBlockOrdering(unsigned long long base_index) const {
         vector<int> block_list;
-        vector<pair<int,double>> block_scores;
+        vector<int> candidates;
 
         for (auto block : ftl->freeList){
-            double score = ftl->getBlockScore(block->blockNo, base_index, writing_sequence);
-            block_scores.emplace_back((pair<int,double>{block->blockNo,score}));
+            candidates.push_back(block->blockNo);
         }
 
         //TODO: adjust k
         ftl->updateMinValid();
-        for (int k = ftl->Y ; k <= (page_dist == UNIFORM ? ftl->Y + 1 : PAGES_PER_BLOCK-1) ; k++) {
-            for (int block_num : ftl->V[k]) {
-                double score = ftl->getBlockScore(block_num, base_index, writing_sequence);
-                block_scores.emplace_back(pair<int, double>{block_num, score});
+        for (int k = ftl->Y ; k <= (page_dist == UNIFORM ? ftl->Y + 1 : geometry.pages_per_block-1) ; k++) {
+            for (int block_num : ftl->V.bucket(k)) {
+                candidates.push_back(block_num);
             }
         }
 
+        vector<double> scores;
+        ftl->getBlockScores(candidates, base_index, &scores);
+        vector<pair<int,double>> block_scores;
+        for (unsigned int i = 0; i < candidates.size(); i++) {
+            block_scores.emplace_back(pair<int, double>{candidates[i], scores[i]});
+        }
+
         std::sort(block_scores.begin(),block_scores.end(),[] (const pair<int,double>& l_val, const pair<int,double>& r_val) {
             return l_val.second < r_val.second;
         });
@@ -450,35 +807,56 @@ public:
         return block_list;
     }
 
-    void updateBlockNumAndWritesCount(int* i, int* writes_in_block, vector<int> blocks) const{
-        while (*writes_in_block == PAGES_PER_BLOCK){
+    void updateBlockNumAndWritesCount(int* i, int* writes_in_block, const vector<int>& blocks) const{
+        while (*writes_in_block == geometry.pages_per_block){
             (*i)++;
             *writes_in_block = ftl->getValidWritesInBlock(blocks[*i]);
         }
     }
 
-    void assignWritesToBlocks(map<unsigned int,ListItem>* locations_list, vector<pair<unsigned int,int>>* res, vector<int> blocks, unsigned long long base_index){
+    void assignWritesToBlocks(LocationIndex* locations, vector<pair<unsigned int,int>>* res, const vector<int>& blocks, unsigned long long base_index){
 
         int i = 0;
         int writes_in_block = ftl->getValidWritesInBlock(blocks[i]);
         updateBlockNumAndWritesCount(&i,&writes_in_block,blocks);
 
-        /* assign all invalid pages. i.e pages that will be overwritten within this window */
-        auto next_block_indexes = getNextBlockIndexes(locations_list,PAGES_PER_BLOCK-writes_in_block);
-        while(!next_block_indexes.empty()){
-            for (unsigned int j = 0 ; j < next_block_indexes.size() ; j++){
-                /* NOTE: loc represents the absolute location in the writing_sequence, but we want to access
+        /* assign all invalid pages. i.e pages that will be overwritten within this window.
+         * the pages are taken in the order of their next overwrite: a min heap holds (next overwrite, slot) of every
+         * page that is written again in the window, and every block takes the pages that are overwritten first.
+         * the pages a block took go back to the heap with their following overwrite once the block is filled, so
+         * the window is planned in O(W log W).
+         */
+        vector<pair<long long,int>> overwrites;
+        for (unsigned int slot = 0; slot < locations->size(); slot++) {
+            long long loc = locations->second(slot);
+            if (loc != NOT_EXIST){
+                overwrites.emplace_back(loc, slot);
+            }
+        }
+        std::priority_queue<pair<long long,int>, vector<pair<long long,int>>, std::greater<pair<long long,int>>>
+                next_overwrites(std::greater<pair<long long,int>>(), std::move(overwrites));
+        vector<int> taken;
+        while(!next_overwrites.empty()){
+            taken.clear();
+            while ((int)taken.size() < geometry.pages_per_block - writes_in_block && !next_overwrites.empty()){
+                int slot = next_overwrites.top().second;
+                next_overwrites.pop();
+                /* NOTE: the first location of the page is absolute in the writing_sequence, but we want to access
                  * res in the location relative to the base index
                  */
-                unsigned long long loc = locations_list->at(writing_sequence[next_block_indexes[j]]).getFirstLocationInList();
-                res->at(loc-base_index).second = blocks[i]; // we need the first location in the list!
+                res->at(locations->first(slot) - base_index).second = blocks[i];
+                taken.push_back(slot);
+            }
+            for (int slot : taken){
+                locations->pop(slot);
+                long long loc = locations->second(slot);
+                if (loc != NOT_EXIST){
+                    next_overwrites.emplace(loc, slot);
+                }
             }
 
-            updateLocationsList(locations_list,next_block_indexes);
-
-            writes_in_block += next_block_indexes.size();
+            writes_in_block += taken.size();
             updateBlockNumAndWritesCount(&i,&writes_in_block,blocks);
-            next_block_indexes = getNextBlockIndexes(locations_list,PAGES_PER_BLOCK-writes_in_block);
         }
 
         /* assign all local valid pages. i.e pages that will remain valid in the end of this window. In order to do
@@ -494,7 +872,7 @@ public:
                 indexes_to_sort.emplace_back(j);
             }
         }
-        sortIndexes(&indexes_to_sort);
+        sortIndexes(&indexes_to_sort, base_index);
         for (unsigned int j = 0 ; j < indexes_to_sort.size(); j++){
             updateBlockNumAndWritesCount(&i,&writes_in_block,blocks);
             res->at(indexes_to_sort[j]).second = blocks[i];
@@ -503,36 +881,18 @@ public:
 
     }
 
-    static vector<long long> getNextBlockIndexes(map<unsigned int,ListItem>* locations_list, int number_of_indexes){
-        vector<long long> locations_of_writes;
-        for (auto & it : *locations_list) {
-            long long loc = it.second.getPageLocation();
-            if (loc != NOT_EXIST){
-                locations_of_writes.push_back(loc);
-            }
-        }
-        std::sort(locations_of_writes.begin(),locations_of_writes.end());
-        long long offset = min(locations_of_writes.size(),number_of_indexes);
-        vector<long long> res(offset);
-        std::copy(locations_of_writes.begin(),locations_of_writes.begin()+offset,res.begin());
-        return res;
-    }
-
-    void updateLocationsList(map<unsigned int,ListItem>* locations_list, const vector<long long>& indexes_to_remove) const{
-        for (int i : indexes_to_remove){
-            locations_list->at(writing_sequence[i]).updateLocationList();
-        }
-    }
-
-    void sortIndexes(vector<long long>* indexes_to_sort) {
-        std::sort(indexes_to_sort->begin(),indexes_to_sort->end(),[this] (int l_val, int r_val) {
-            return pageScore(l_val) < pageScore(r_val);
+    /* sort indexes (relative to base_index) by the page score of the page written there */
+    void sortIndexes(vector<long long>* indexes_to_sort, unsigned long long base_index) {
+        std::sort(indexes_to_sort->begin(),indexes_to_sort->end(),[this, base_index] (int l_val, int r_val) {
+            return pageScore(base_index + l_val) < pageScore(base_index + r_val);
         });
     }
 
+    /* the next location after page_index where the page written in page_index is written again
+     * (N if it is not written again within the lookahead horizon)
+     */
     unsigned long long pageScore(unsigned long long page_index) const{
-        unsigned int lpn = writing_sequence[page_index];
-        return logical_pages_location_map->at(lpn).getFirstLocationAfterIndex(page_index);
+        return lookahead_index->nextOccurrence(page_index);
     }
 
     void runGenerationalSimulation(int num_of_gens, unsigned long long window_size) {
@@ -545,9 +905,13 @@ public:
             ftl->gen_blocks.insert({j, new_gen_block});
         }
 
-        for (unsigned long long i = 0; i < window_size; ++i) {
+        startMeasurement();
+        for (unsigned long long i = 0; i < window_size && !measurementConverged(); ++i) {
+            lookahead_index->extendWindow(i);
             int generation = getGeneration(i, num_of_gens);
-            ftl->writeGenerational(data, writing_sequence[i], generation, writing_sequence, i);
+            ftl->writeGenerational(data, writing_sequence->at(i), generation, i);
+            lookahead_index->advance(i);
+            writing_sequence->release(i + 1);
         }
         for(std::map<int,Block*>::iterator it = ftl->gen_blocks.begin(); it!=ftl->gen_blocks.end(); it++){
             /* push generational blocks to freelist */
@@ -557,14 +921,15 @@ public:
             }
         }
         ftl->gen_blocks.clear();
-        for (unsigned long long i = window_size; i < NUMBER_OF_PAGES; i++) {
-            ftl->write(data,writing_sequence[i],GREEDY, writing_sequence, i);
+        for (unsigned long long i = window_size; i < number_of_pages && !measurementConverged(); i++) {
+            ftl->write(data,writing_sequence->at(i),GREEDY, i);
+            writing_sequence->release(i + 1);
         }
     }
 
     int getGeneration(unsigned long long page_index, int num_of_gens) const{
         unsigned long long page_score = pageScore(page_index) - page_index;
-        int interval = (PAGES_PER_BLOCK*LOGICAL_BLOCK_NUMBER)/num_of_gens; //TODO: adjust this
+        int interval = geometry.logicalPages()/num_of_gens; //TODO: adjust this
         unsigned long long bound = interval;
         for (int i = 0; i < num_of_gens-1; ++i) {
             if(page_score < bound)
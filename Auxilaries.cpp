@@ -26,9 +26,30 @@ Algorithm algoStringToEnum(const char* string){
     if (strcmp(string,"writing_assignment") == 0){
         return WRITING_ASSIGNMENT;
     }
+    if (strcmp(string,"oracle") == 0){
+        return ORACLE;
+    }
     return INVALID_ALGO;
 }
 
+vector<Algorithm> algoListStringToEnum(const char* string){
+    vector<Algorithm> algorithms;
+    std::string names(string);
+    size_t begin = 0;
+    while (true) {
+        size_t comma = names.find(',', begin);
+        Algorithm algo = algoStringToEnum(names.substr(begin, comma - begin).c_str());
+        if (algo == INVALID_ALGO){
+            return vector<Algorithm>();
+        }
+        algorithms.push_back(algo);
+        if (comma == std::string::npos){
+            return algorithms;
+        }
+        begin = comma + 1;
+    }
+}
+
 PageDistribution distributionStringToEnum(const char* string){
     if (strcmp(string,"uniform") == 0){
         return UNIFORM;
@@ -36,9 +57,43 @@ PageDistribution distributionStringToEnum(const char* string){
     if (strcmp(string,"hot_cold") == 0){
         return HOT_COLD;
     }
+    /* trace=<path of a binary trace file> */
+    if (strncmp(string,"trace=",6) == 0 && string[6] != '\0'){
+        return TRACE;
+    }
     return INVALID_DIST;
 }
 
+const char* algoEnumToString(Algorithm algo){
+    switch (algo) {
+        case GREEDY:
+            return "greedy";
+        case GREEDY_LOOKAHEAD:
+            return "greedy_lookahead";
+        case GENERATIONAL:
+            return "generational";
+        case WRITING_ASSIGNMENT:
+            return "writing_assignment";
+        case ORACLE:
+            return "oracle";
+        default:
+            return "invalid";
+    }
+}
+
+const char* distributionEnumToString(PageDistribution page_dist){
+    switch (page_dist) {
+        case UNIFORM:
+            return "uniform";
+        case HOT_COLD:
+            return "hot_cold";
+        case TRACE:
+            return "trace";
+        default:
+            return "invalid";
+    }
+}
+
 WindowSizeFlag windowSizeFlagToEnum(const char* string){
     if(strcmp(string, "window_on") == 0)
         return WINDOW_SIZE_ON;
@@ -47,3 +102,23 @@ WindowSizeFlag windowSizeFlagToEnum(const char* string){
     return INVALID_WINDOW_SIZE_FLAG;
 }
 
+SequenceGenerator generatorStringToEnum(const char* string){
+    if (strcmp(string,"kiss") == 0){
+        return KISS_GENERATOR;
+    }
+    if (strcmp(string,"philox") == 0){
+        return PHILOX_GENERATOR;
+    }
+    return INVALID_GENERATOR;
+}
+
+const char* generatorEnumToString(SequenceGenerator generator){
+    switch (generator) {
+        case KISS_GENERATOR:
+            return "kiss";
+        case PHILOX_GENERATOR:
+            return "philox";
+        default:
+            return "invalid";
+    }
+}
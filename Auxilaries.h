@@ -6,37 +6,46 @@
 #define FLASHGC_AUXILARIES_H
 
 #include <cstring>
-
-typedef enum {
-    FREE_LOGICAL, USED_LOGICAL
-} LogicalPageStatus;
+#include <vector>
 
 typedef enum {
     FREE_PHYSICAL, OBSOLETE, VALID
 } PhysicalPageStatus;
 
 typedef enum {
-    UNIFORM, HOT_COLD, INVALID_DIST
+    UNIFORM, HOT_COLD, TRACE, INVALID_DIST
 } PageDistribution;
 
 typedef enum {
-    GREEDY, GREEDY_LOOKAHEAD, GENERATIONAL, WRITING_ASSIGNMENT, INVALID_ALGO
+    GREEDY, GREEDY_LOOKAHEAD, GENERATIONAL, WRITING_ASSIGNMENT, ORACLE, INVALID_ALGO
 } Algorithm;
 
-typedef enum {
-    HOT, COLD, COIN_TOSS
-} RandVariable;
-
 typedef enum {
     WINDOW_SIZE_ON, WINDOW_SIZE_OFF, INVALID_WINDOW_SIZE_FLAG
 }WindowSizeFlag;
 
+/* the generator of the synthetic writing sequences */
+typedef enum {
+    KISS_GENERATOR, PHILOX_GENERATOR, INVALID_GENERATOR
+} SequenceGenerator;
+
 Algorithm algoStringToEnum(const char* string);
 
+/* comma separated list of algorithms (e.g "greedy,generational"). returns an empty list if a name is invalid */
+std::vector<Algorithm> algoListStringToEnum(const char* string);
+
 PageDistribution distributionStringToEnum(const char* string);
 
 WindowSizeFlag windowSizeFlagToEnum(const char* string);
 
+const char* algoEnumToString(Algorithm algo);
+
+const char* distributionEnumToString(PageDistribution page_dist);
+
+SequenceGenerator generatorStringToEnum(const char* string);
+
+const char* generatorEnumToString(SequenceGenerator generator);
+
 unsigned int min(unsigned int a,unsigned int b);
 
 #endif //FLASHGC_AUXILARIES_H
@@ -6,6 +6,9 @@
 #define FTL_HPP_
 
 #include <cstdlib>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
 #include <cassert>
 #include <algorithm>
 #include <cmath>
@@ -14,6 +17,13 @@
 #include <map>
 #include <vector>
 #include "Auxilaries.h"
+#include "LookaheadIndex.h"
+#include "OracleQueue.h"
+#include "ValidBuckets.h"
+#include "Geometry.h"
+#include "Profiler.h"
+#include "ThreadPool.h"
+#include "TimeSeriesRecorder.h"
 #include "main.hpp"
 
 /* Main module for the Flash simulation */
@@ -21,75 +31,226 @@
 #define NA	-15
 #define BLOCK_FULL -71
 
+/* snapshot files (FTL::saveSnapshot / FTL::loadSnapshot) */
+#define SNAPSHOT_MAGIC "FGCSNAP"
+#define SNAPSHOT_VERSION 1
+
 using std::map;
 using std::vector;
 using std::set;
 using std::pair;
 
-/* forward decleration */
-class PhysicalPage;
+/* The mapping tables are compact integer arrays:
+ * mappingTable (L2P) - for every logical page number (LPN), the physical page number (PPN) it is mapped to,
+ * 						or UNMAPPED_PAGE if the logical page was never written.
+ * reverseMappingTable (P2L) - for every physical page number, the logical page number mapped to it, or one of
+ * 						FREE_PAGE (unused page) / OBSOLETE_PAGE (used but a logical page is no longer mapped to it).
+ * physical page number PPN is page PPN % Z of block PPN / Z.
+ */
 
-/* The Logical Page data structure */
+#define UNMAPPED_PAGE	0xFFFFFFFFu
+#define FREE_PAGE		0xFFFFFFFFu
+#define OBSOLETE_PAGE	0xFFFFFFFEu
 
-class LogicalPage {
-public:
+/* number of blocks the batch score kernel scores together (the lanes of a batch) */
+#define SCORE_BATCH_LANES 8
 
-	/* pointer to the physical page the logical page is mapped to */
+/* the victim candidates of greedy_lookahead are scored SCORE_CHUNK_BLOCKS at a time into a buffer on the stack */
+#define SCORE_CHUNK_BLOCKS 64
 
-	PhysicalPage* physicalPage;
+/* a candidate set is split between the threads of FTL::score_pool only if every thread gets at least this many
+ * blocks. a smaller set is scored faster than the workers wake up
+ */
+#define SCORE_PARALLEL_MIN_BLOCKS 256
 
-	/* logical page status: FREE_LOGICAL or USED_LOGICAL */
+/* largest candidate depth of greedy_lookahead (see FTL::candidateScore for why deeper searches are not allowed) */
+#define MAX_CANDIDATE_DEPTH 4
 
-	LogicalPageStatus status;
+/* per block kernels. the loops over the pages and the valid bitmap of a block run with Z (pages per block) as
+ * their trip count, so they are templated on Z: BlockKernels::specialized<Z>() has Z as a compile time constant
+ * and the compiler can unroll and vectorize the loops, while BlockKernels::specialized<0>() is the generic
+ * version that reads Z at runtime. selectBlockKernels() picks the right one when the FTL is constructed.
+ */
 
-	LogicalPage() :
-			physicalPage(nullptr), status(FREE_LOGICAL) {
-	}
+class BlockKernels {
+public:
 
-	void clear() {
-		physicalPage = nullptr;
-		status = FREE_LOGICAL;
-	}
+	/* mark all pages of the block as free and clear its valid bitmap */
 
-};
+	void (*clean)(uint32_t* pages, uint64_t* bitmap, int pages_per_block);
 
-/* the Physical Page data structure */
+	/* number of valid pages, counted on the bitmap */
 
-class PhysicalPage {
-public:
+	int (*countValid)(const uint64_t* bitmap, int pages_per_block);
 
-	/* the number of the physical block */
+	/* copy the logical page numbers of the valid pages, in ascending page order, and return their number */
 
-	int blockNo;
+	int (*collectValid)(const uint32_t* pages, const uint64_t* bitmap, int pages_per_block,
+			unsigned int* logical_pages);
 
-	/* the number of the physical page within the block */
+	/* block score: sum of score_weights[min(next_write[lpn] - base_index, horizon)] over the valid pages */
 
-	int pageNo;
+	double (*blockScore)(const uint32_t* pages, const uint64_t* bitmap, int pages_per_block,
+			const unsigned long long* next_write, const double* score_weights, unsigned long long base_index,
+			unsigned long long horizon);
 
-	/* physical page status: 	FREE_PHYSICAL - Unused page
-	 * 							OBSOLETE - used but a logical page is no longer
-	 * 							mapped to this page.
-	 * 							VALID - a logical page is mapped to this page
+	/* block scores of a batch of up to SCORE_BATCH_LANES blocks: scores[lane] is blockScore of the block with
+	 * pages[lane] and bitmaps[lane]. distances is a scratch buffer of pages_per_block * SCORE_BATCH_LANES entries
 	 */
 
-	PhysicalPageStatus status;
+	void (*blockScores)(const uint32_t* const* pages, const uint64_t* const* bitmaps, int lanes,
+			int pages_per_block, const unsigned long long* next_write, const double* score_weights,
+			unsigned long long base_index, unsigned long long horizon, unsigned int* distances, double* scores);
+
+	template <int Z>
+	static BlockKernels specialized() {
+		BlockKernels kernels;
+		kernels.clean = &cleanImpl<Z>;
+		kernels.countValid = &countValidImpl<Z>;
+		kernels.collectValid = &collectValidImpl<Z>;
+		kernels.blockScore = &blockScoreImpl<Z>;
+		kernels.blockScores = &blockScoresImpl<Z>;
+		return kernels;
+	}
 
-	/* pointer to the logical page which is mapped to this physical page */
+private:
 
-	LogicalPage* logicalPage;
+	/* Z for the specialized kernels, the runtime value for the generic ones (Z == 0) */
 
-	PhysicalPage() :
-			blockNo(NA), pageNo(NA), status(FREE_PHYSICAL), logicalPage(nullptr) {
+	template <int Z>
+	static int pagesPerBlock(int pages_per_block) {
+		return Z ? Z : pages_per_block;
 	}
 
-	/* obsolete handling */
+	template <int Z>
+	static void cleanImpl(uint32_t* pages, uint64_t* bitmap, int pages_per_block) {
+		const int z = pagesPerBlock<Z>(pages_per_block);
+		for (int i = 0; i < z; i++) {
+			pages[i] = FREE_PAGE;
+		}
+		for (int w = 0; w < (z + 63) / 64; w++) {
+			bitmap[w] = 0;
+		}
+	}
 
-	void obsolete() {
-		status = OBSOLETE;
-		logicalPage = nullptr;
+	template <int Z>
+	static int countValidImpl(const uint64_t* bitmap, int pages_per_block) {
+		const int z = pagesPerBlock<Z>(pages_per_block);
+		int count = 0;
+		for (int w = 0; w < (z + 63) / 64; w++) {
+			count += __builtin_popcountll(bitmap[w]);
+		}
+		return count;
+	}
+
+	template <int Z>
+	static int collectValidImpl(const uint32_t* pages, const uint64_t* bitmap, int pages_per_block,
+			unsigned int* logical_pages) {
+		const int z = pagesPerBlock<Z>(pages_per_block);
+		int counter = 0;
+		for (int w = 0; w < (z + 63) / 64; w++) {
+			uint64_t bits = bitmap[w];
+			while (bits) {
+				logical_pages[counter++] = pages[(w << 6) + __builtin_ctzll(bits)];
+				bits &= bits - 1;
+			}
+		}
+		return counter;
+	}
+
+	template <int Z>
+	static double blockScoreImpl(const uint32_t* pages, const uint64_t* bitmap, int pages_per_block,
+			const unsigned long long* next_write, const double* score_weights, unsigned long long base_index,
+			unsigned long long horizon) {
+		const int z = pagesPerBlock<Z>(pages_per_block);
+		double block_score = 0;
+		for (int w = 0; w < (z + 63) / 64; w++) {
+			uint64_t bits = bitmap[w];
+			while (bits) {
+				unsigned long long next = next_write[pages[(w << 6) + __builtin_ctzll(bits)]];
+				assert(next >= base_index);
+				block_score += score_weights[std::min(next - base_index, horizon)];
+				bits &= bits - 1;
+			}
+		}
+		return block_score;
+	}
+
+	/* the batch is scored in two passes. the gather pass writes the distance to the next write of every valid
+	 * page into distances[slot * SCORE_BATCH_LANES + lane] (slot is the index of the page among the valid pages
+	 * of the block in lane), and pads the lanes with fewer valid pages with distance 0, whose weight
+	 * score_weights[0] is 0. it also prefetches the weight of every distance, so the random reads of the weights
+	 * table overlap with the gather. the sum pass then adds a whole row of weights at a time: every lane is an
+	 * independent chain of additions that the compiler can vectorize, and it adds the weights of its block in
+	 * page order, so the scores are exactly the ones of blockScore.
+	 */
+	template <int Z>
+	static void blockScoresImpl(const uint32_t* const* pages, const uint64_t* const* bitmaps, int lanes,
+			int pages_per_block, const unsigned long long* next_write, const double* score_weights,
+			unsigned long long base_index, unsigned long long horizon, unsigned int* distances, double* scores) {
+		const int z = pagesPerBlock<Z>(pages_per_block);
+		int counts[SCORE_BATCH_LANES] = {};
+		int rows = 0;
+		for (int lane = 0; lane < lanes; lane++) {
+			int slot = 0;
+			for (int w = 0; w < (z + 63) / 64; w++) {
+				uint64_t bits = bitmaps[lane][w];
+				while (bits) {
+					unsigned long long next = next_write[pages[lane][(w << 6) + __builtin_ctzll(bits)]];
+					assert(next >= base_index);
+					unsigned int distance = std::min(next - base_index, horizon);
+					__builtin_prefetch(score_weights + distance);
+					distances[slot++ * SCORE_BATCH_LANES + lane] = distance;
+					bits &= bits - 1;
+				}
+			}
+			counts[lane] = slot;
+			rows = std::max(rows, slot);
+		}
+		for (int lane = 0; lane < SCORE_BATCH_LANES; lane++) {
+			for (int slot = counts[lane]; slot < rows; slot++) {
+				distances[slot * SCORE_BATCH_LANES + lane] = 0;
+			}
+		}
+
+		double sums[SCORE_BATCH_LANES] = {};
+		for (int slot = 0; slot < rows; slot++) {
+			const unsigned int* row = distances + slot * SCORE_BATCH_LANES;
+			for (int lane = 0; lane < SCORE_BATCH_LANES; lane++) {
+				sums[lane] += score_weights[row[lane]];
+			}
+		}
+		for (int lane = 0; lane < lanes; lane++) {
+			scores[lane] = sums[lane];
+		}
 	}
 };
 
+/* the kernels for a given number of pages per block: specialized for the common values of Z, generic otherwise */
+
+inline const BlockKernels* selectBlockKernels(int pages_per_block) {
+	static const BlockKernels kernels_32 = BlockKernels::specialized<32>();
+	static const BlockKernels kernels_64 = BlockKernels::specialized<64>();
+	static const BlockKernels kernels_128 = BlockKernels::specialized<128>();
+	static const BlockKernels kernels_256 = BlockKernels::specialized<256>();
+	static const BlockKernels kernels_512 = BlockKernels::specialized<512>();
+	static const BlockKernels kernels_generic = BlockKernels::specialized<0>();
+	switch (pages_per_block) {
+	case 32:
+		return &kernels_32;
+	case 64:
+		return &kernels_64;
+	case 128:
+		return &kernels_128;
+	case 256:
+		return &kernels_256;
+	case 512:
+		return &kernels_512;
+	default:
+		return &kernels_generic;
+	}
+}
+
 /* the Physical Block data structure */
 
 class Block {
@@ -99,9 +260,25 @@ public:
 
 	int blockNo;
 
-	/* dynamic array of physical pages of histogram_size PAGES_PER_BLOCK */
+	/* geometry of the device the block belongs to */
+
+	const Geometry* geometry;
+
+	/* per block kernels for the geometry's Z */
+
+	const BlockKernels* kernels;
+
+	/* the reverse mapping of the Z physical pages of the block (its slice of the P2L table) */
 
-	PhysicalPage* pages;
+	uint32_t* pages;
+
+	/* the FTL mapping table (L2P), updated when a logical page is written to this block */
+
+	uint32_t* mappingTable;
+
+	/* valid bitmap of the block inside the FTL bitmap arena: bit i is set iff page i is VALID */
+
+	uint64_t* validBitmap;
 
 	/* number of logical pages mapped to this block */
 
@@ -112,60 +289,112 @@ public:
 	int nextFree;
 
 	Block() :
-            blockNo(NA), pages(new PhysicalPage[PAGES_PER_BLOCK]), valid(0), nextFree(
+            blockNo(NA), geometry(nullptr), kernels(nullptr), pages(nullptr), mappingTable(nullptr), validBitmap(nullptr), valid(0), nextFree(
 					0) {
-		for (int i = 0; i < PAGES_PER_BLOCK; i++) {
-			pages[i].pageNo = i;
+	}
+
+	/* place the block on its slice of the reverse mapping table and bitmap arena */
+
+	void attach(int block_no, const Geometry* block_geometry, const BlockKernels* block_kernels,
+			uint32_t* block_pages, uint32_t* mapping_table, uint64_t* bitmap) {
+		blockNo = block_no;
+		geometry = block_geometry;
+		kernels = block_kernels;
+		pages = block_pages;
+		mappingTable = mapping_table;
+		validBitmap = bitmap;
+	}
+
+	/* physical page number of page page_no of this block */
+
+	uint32_t physicalPageNumber(int page_no) const {
+		return (uint32_t)blockNo * geometry->pages_per_block + page_no;
+	}
+
+	bool isValid(int page_no) const {
+		return (validBitmap[page_no >> 6] >> (page_no & 63)) & 1;
+	}
+
+	/* physical page status: 	FREE_PHYSICAL - Unused page
+	 * 							OBSOLETE - used but a logical page is no longer
+	 * 							mapped to this page.
+	 * 							VALID - a logical page is mapped to this page
+	 */
+
+	PhysicalPageStatus pageStatus(int page_no) const {
+		if (pages[page_no] == FREE_PAGE) {
+			return FREE_PHYSICAL;
 		}
+		if (pages[page_no] == OBSOLETE_PAGE) {
+			return OBSOLETE;
+		}
+		return VALID;
 	}
-	~Block() {
-		delete[] pages;
+
+	/* number of valid pages, counted on the bitmap */
+
+	int countValid() const {
+		return kernels->countValid(validBitmap, geometry->pages_per_block);
 	}
 
 	/* obsolete pages update */
 
-	void obsolete(PhysicalPage* page) {
+	void obsolete(int page_no) {
 		valid--;
-		page->obsolete();
+		pages[page_no] = OBSOLETE_PAGE;
+		validBitmap[page_no >> 6] &= ~(1ULL << (page_no & 63));
+	}
+
+	/* call func(page_no) for every valid page of the block, in ascending page order.
+	 * uses find-first-set on the bitmap so only the valid pages are visited.
+	 */
+
+	template <class Func>
+	void forEachValid(Func func) const {
+		for (int w = 0; w < geometry->bitmapWords(); w++) {
+			uint64_t bits = validBitmap[w];
+			while (bits) {
+				func((w << 6) + __builtin_ctzll(bits));
+				bits &= bits - 1;
+			}
+		}
 	}
 
+	/* mark all pages as free */
+
+	void clean() {
+		kernels->clean(pages, validBitmap, geometry->pages_per_block);
+		valid = 0;
+		nextFree = 0;
+	}
 
 	/* all valid pages are rewritten contiguously from the beginning of the
 	 * block
 	 */
 
-	void copyValidToTempAndClean(char* data, LogicalPage* logicalPages[],
+	void copyValidToTempAndClean(char* data, unsigned int logicalPages[],
                                  int* counter) {
-		*counter = 0;
+		*counter = kernels->collectValid(pages, validBitmap, geometry->pages_per_block, logicalPages);
 
 		/* read valid data to temp buffer */
 
-		for (int i = 0; i < PAGES_PER_BLOCK; i++) {
-			if (pages[i].status == VALID) {
-				read(data + (*counter) * PAGE_SIZE, pages[i].logicalPage);
-				logicalPages[*counter] = pages[i].logicalPage;
-				(*counter)++;
-			}
-			pages[i].status = FREE_PHYSICAL;
-			pages[i].logicalPage = nullptr;
+		for (int i = 0; i < *counter; i++) {
+			read(data + i * geometry->page_size, logicalPages[i]);
 		}
 
-		valid = 0;
-		nextFree = 0;
+		clean();
 	}
 
 	/* if block is full, perform clean.
 	 * write data to one physical page.
 	 */
 
-	int write(char* data, LogicalPage* page) {
-		PhysicalPage* current = &(pages[nextFree]);
-		page->physicalPage = current;
-		page->status = USED_LOGICAL;
-		current->logicalPage = page;
-		current->status = VALID;
+	int write(char* data, unsigned int lpn) {
+		mappingTable[lpn] = physicalPageNumber(nextFree);
+		pages[nextFree] = lpn;
+		validBitmap[nextFree >> 6] |= 1ULL << (nextFree & 63);
 		valid++;
-		if (nextFree == PAGES_PER_BLOCK - 1) {
+		if (nextFree == geometry->pages_per_block - 1) {
 			nextFree = BLOCK_FULL;
 			return BLOCK_FULL;
 		}
@@ -180,7 +409,7 @@ public:
 	 * you can implement this according to your needs.
 	 */
 
-	void read(char* buffer, LogicalPage* page) {
+	void read(char* buffer, unsigned int lpn) {
 	    // read data to buffer...
 	}
 };
@@ -190,25 +419,40 @@ public:
 class FTL {
 public:
 
-	/* Mapping table of the logical pages */
+	/* geometry of the simulated device */
+
+	const Geometry geometry;
 
-	LogicalPage* mappingTable;
+	/* per block kernels, specialized for the geometry's Z when possible */
+
+	const BlockKernels* kernels;
+
+	/* Mapping table of the logical pages (L2P): logical page number -> physical page number */
+
+	uint32_t* mappingTable;
+
+	/* Reverse mapping table (P2L): physical page number -> logical page number / FREE_PAGE / OBSOLETE_PAGE */
+
+	uint32_t* reverseMappingTable;
 
 	/* Array of blocks */
 
-	Block** blocks;
+	Block* blocks;
+
+	/* arena of the valid bitmaps of all blocks, geometry.bitmapWords() words per block */
+
+	uint64_t* validBitmapArena;
 
 	/* List of pointers to free pages */
 
 	std::list<Block*> freeList;
 
-	/* V is an array of sets of integers of histogram_size PAGES_PER_BLOCK+1. each
-	 * integer refers to a block number.
-	 * set V[i], 0<=i<=PAGES_PER_BLOCK, is a set of all the blocks with i valid
+	/* V is an array of Z+1 buckets of block numbers.
+	 * bucket V.bucket(i), 0<=i<=Z, holds all the full blocks with i valid
 	 * pages.
 	 */
 
-	set<int>* V;
+	ValidBuckets V;
 
 	/* Y - the minimum number of valid pages in a block */
 
@@ -216,29 +460,29 @@ public:
 
 	/* total number of block erases */
 
-	int erases;
+	unsigned long long erases;
 
 	/* number of block erases in steady state phase */
 
-	int erases_steady;
+	unsigned long long erases_steady;
 
 	/* logical page writes */
 
-	int logicalPageWrites;
-	int logicalPageWritesSteady;
+	unsigned long long logicalPageWrites;
+	unsigned long long logicalPageWritesSteady;
 
 	/* physical page writes */
 
-	int physicalPageWrites;
-    int physicalPageWritesSteady;
+	unsigned long long physicalPageWrites;
+    unsigned long long physicalPageWritesSteady;
 
 	/* blocks for writing pages by generation, used for generational GC algorithm */
 	map<int, Block*> gen_blocks;
 
-	/* indicator for printing mode. if turned on, the V array will be printed with every block erasure,
-	 * along with the number of logical page writes and Y
+	/* if set, the V histogram, the number of logical page writes and Y are recorded on block erasures.
+	 * not owned by the FTL, and not copied to forks
 	 */
-	bool print_mode;
+	TimeSeriesRecorder* recorder;
 
     /* optimized parameters for the given OP that we are currently running with.
      * This is a pair (n,num_of_generations) where:
@@ -247,48 +491,100 @@ public:
      * */
     std::pair<int,int> optimized_params;
 
-	explicit FTL() :
-            mappingTable(
-					new LogicalPage[LOGICAL_BLOCK_NUMBER * PAGES_PER_BLOCK]), blocks(
-					new Block*[PHYSICAL_BLOCK_NUMBER]), V(
-					new set<int> [PAGES_PER_BLOCK + 1]), Y(0), erases(0), erases_steady(0), logicalPageWrites(
+    /* next write index over the writing sequence, used by the lookahead algorithms. not owned by the FTL */
+    const LookaheadIndex* lookahead_index;
+
+    /* prefix sums of the block score weights: score_weights[k] = sum over 0<=d<k of 1/d^n (where the d=0
+     * term is 1). a page that is overwritten d writes from now adds score_weights[d] to its block score.
+     */
+    vector<double> score_weights;
+
+    /* state of the oracle victim selection (ORACLE): the dying pages of every block and the heap of the full
+     * blocks. built on the first ORACLE write and dropped on a write of any other algorithm (the counts follow
+     * the lookahead index only while ORACLE writes). not copied to forks
+     */
+    OracleQueue* oracle;
+
+    /* a page is dying if its next write is before oracle_end: base_index + the oracle horizon (bounded by the
+     * frontier of the lookahead index)
+     */
+    unsigned long long oracle_end;
+
+    /* the victim candidates of greedy_lookahead are the full blocks of the candidate_depth + 1 lowest buckets,
+     * at most candidate_blocks of them (0 - no limit). see getBestBlockToEvict
+     */
+    int candidate_depth;
+    int candidate_blocks;
+
+    /* if set, large candidate sets are scored on its threads. not owned by the FTL. set with setScorePool */
+    ThreadPool* score_pool;
+
+    /* scratch buffers of the batch score kernel, pages_per_block * SCORE_BATCH_LANES entries each: one for the
+     * calling thread and one per thread of score_pool, allocated once and not on every call. the const scoring
+     * methods write to them, so they must not run concurrently on one FTL (except the tasks of getBestBlockToEvict,
+     * which use a buffer each)
+     */
+    unsigned int* score_distances;
+    int score_distance_buffers;
+
+	explicit FTL(const Geometry& geometry) :
+            geometry(geometry), kernels(selectBlockKernels(geometry.pages_per_block)), mappingTable(
+					new uint32_t[geometry.logicalPages()]), reverseMappingTable(
+					new uint32_t[geometry.physicalPages()]), blocks(
+					new Block[geometry.physical_blocks]), validBitmapArena(
+					new uint64_t[geometry.physical_blocks * geometry.bitmapWords()]()), V(
+					geometry.physical_blocks, geometry.pages_per_block), Y(0), erases(0), erases_steady(0), logicalPageWrites(
 					0), logicalPageWritesSteady(0), physicalPageWrites(0), physicalPageWritesSteady(0),
-            print_mode(false) {
-		for (int i = 0; i < PHYSICAL_BLOCK_NUMBER; i++) {
-			blocks[i] = new Block;
-			blocks[i]->blockNo = i;
-			freeList.push_back(blocks[i]);
-			for (int j = 0; j < PAGES_PER_BLOCK; j++) {
-				blocks[i]->pages[j].blockNo = i;
-			}
+            recorder(nullptr), lookahead_index(nullptr), oracle(nullptr), oracle_end(0),
+            candidate_depth(0), candidate_blocks(0), score_pool(nullptr),
+            score_distances(new unsigned int[geometry.pages_per_block * SCORE_BATCH_LANES]), score_distance_buffers(1) {
+		/* page numbers must not collide with the sentinel values */
+		assert((unsigned long long)geometry.physical_blocks * geometry.pages_per_block < OBSOLETE_PAGE);
+		for (unsigned int i = 0; i < geometry.logicalPages(); i++) {
+			mappingTable[i] = UNMAPPED_PAGE;
+		}
+		for (int i = 0; i < geometry.physical_blocks; i++) {
+			blocks[i].attach(i, &this->geometry, kernels, reverseMappingTable + i * geometry.pages_per_block, mappingTable,
+					validBitmapArena + i * geometry.bitmapWords());
+			blocks[i].clean();
+			freeList.push_back(&blocks[i]);
 		}
         optimized_params.first = getOptimizedAlphaValParam();
-		optimized_params.second = std::max((int)min(LOGICAL_BLOCK_NUMBER/OVER_LOADING_FACTOR, PHYSICAL_BLOCK_NUMBER-LOGICAL_BLOCK_NUMBER), 1);
+		optimized_params.second = std::max((int)min(geometry.logical_blocks/OVER_LOADING_FACTOR, geometry.physical_blocks-geometry.logical_blocks), 1);
     }
 
 	~FTL() {
 		delete[] mappingTable;
-		for (int i = 0; i < PHYSICAL_BLOCK_NUMBER; i++) {
-			delete blocks[i];
-		}
+		delete[] reverseMappingTable;
 		delete[] blocks;
-		delete[] V;
+		delete[] validBitmapArena;
+		delete[] score_distances;
+		delete oracle;
 	}
 
-	void printHeader() {
-		cout << "Erases\t\tLogical Writes\tY\t";
-		for (int i = 0; i < PAGES_PER_BLOCK + 1; i++) {
-			cout << "V[" << i << "]\t";
+	/* score large candidate sets on the threads of pool (nullptr scores them on the calling thread) */
+	void setScorePool(ThreadPool* pool){
+		score_pool = pool;
+		int buffers = pool ? pool->size() + 1 : 1;
+		if (buffers > score_distance_buffers){
+			delete[] score_distances;
+			score_distances = new unsigned int[buffers * geometry.pages_per_block * SCORE_BATCH_LANES];
+			score_distance_buffers = buffers;
 		}
-		cout << endl;
+	}
+
+	/* the scratch buffer of the kernel for the calling thread (0) or for task i of score_pool (i + 1) */
+	unsigned int* scoreDistances(int buffer) const{
+		assert(buffer < score_distance_buffers);
+		return score_distances + buffer * geometry.pages_per_block * SCORE_BATCH_LANES;
 	}
 
 
 	// not including blocks in freelist
 	int getNumberOfValidPages(){
 	    int counter = 0;
-	    for (int i=0 ; i < PAGES_PER_BLOCK+1 ; i++){
-	        counter = counter + (V[i].size() * i);
+	    for (int i=0 ; i < geometry.pages_per_block+1 ; i++){
+	        counter = counter + (V.size(i) * i);
 	    }
 	    for (auto block : freeList){
 	        counter += block->valid;
@@ -303,12 +599,12 @@ public:
         int minValid = updateMinValid();
 
         int counter = 0;
-        if (minValid <= PAGES_PER_BLOCK){
-            counter = minValid * V[minValid].size();
+        if (minValid <= geometry.pages_per_block){
+            counter = minValid * V.size(minValid);
         }
 
-        for (int i = minValid+1 ; i < PAGES_PER_BLOCK+1 ; i++){
-            counter += V[i].size() * PAGES_PER_BLOCK;
+        for (int i = minValid+1 ; i < geometry.pages_per_block+1 ; i++){
+            counter += V.size(i) * geometry.pages_per_block;
         }
 
         for (auto block : freeList){
@@ -325,11 +621,11 @@ public:
 	Block* choseMinValidOld() {
 		Block* chosen1 = NULL;
 		int temp1;
-		int minValid1 = PAGES_PER_BLOCK + 1;
-		for (int i = 0; i < PHYSICAL_BLOCK_NUMBER; i++) {
-			temp1 = blocks[i]->valid;
-			if (temp1 < minValid1 && (blocks[i]->nextFree == BLOCK_FULL)) {
-				chosen1 = blocks[i];
+		int minValid1 = geometry.pages_per_block + 1;
+		for (int i = 0; i < geometry.physical_blocks; i++) {
+			temp1 = blocks[i].valid;
+			if (temp1 < minValid1 && (blocks[i].nextFree == BLOCK_FULL)) {
+				chosen1 = &blocks[i];
 				minValid1 = temp1;
 			}
 		}
@@ -338,64 +634,92 @@ public:
 	}
 
 	/* finding the block with minimum number of valid pages algorithm:
-	 * go over V1 and V2 from i=0 to the top and find the first i for which
-	 * V1[i] or V2[i] is not empty.
-	 * complexity: update of data structures is O(log(PHYSICAL_BLOCK_NUMBER))
-	 * (the complexity of inserting and deleting from the sets) for each write.
-	 * retrieval of the block with minimum valid pages is O(PAGES_PER_BLOCK).
-	 * now, since when memory is full, number of writes between erases is
-	 * O(PAGES_PER_BLOCK) we get a very fast O(PAGES_PER_BLOCK*log(PHYSICAL_BLOCK_NUMBER)) algorithm.
+	 * V keeps the full blocks in buckets by number of valid pages, and tracks
+	 * the lowest non empty bucket.
+	 * complexity: update of data structures is O(1) for each write (moving a
+	 * block from one linked bucket to another).
+	 * retrieval of the block with minimum valid pages is O(1) amortized: the
+	 * tracked minimum only moves up by scanning when its bucket empties.
 	 */
 
 	/* returns a pointer to the minimum block on 1st write.
-	 * performs this simply by going over N1 and finding the minimal i for
-	 * which V[i] is not empty.
+	 * performs this simply by taking the first block of the lowest non empty
+	 * bucket.
 	 */
 
 	Block* minBlock() {
+		PROFILE_SCOPE(PROFILE_VICTIM_SELECTION);
 		updateMinValid();
-		return blocks[*(V[Y].begin())];
+		return &blocks[V.front(Y)];
 	}
 
-	/* given a LogicalPage object, find the logical page number */
-    int getLogicalPageNumber(LogicalPage* logical_page) const{
-        for (int lpn = 0 ; lpn < LOGICAL_BLOCK_NUMBER * PAGES_PER_BLOCK; ++lpn) {
-            if (&mappingTable[lpn] == logical_page){
-                return lpn;
-            }
-        }
-        return -1 ; // error
+	/* attach the next write index of the writing sequence and build the block score weights table.
+	 * must be called before running any of the lookahead algorithms.
+	 */
+	void setLookaheadIndex(const LookaheadIndex* index){
+	    lookahead_index = index;
+	    int horizon = geometry.pages_per_block*geometry.physical_blocks;
+	    score_weights.assign(horizon + 1, 0);
+	    for (int d = 0; d < horizon; d++) {
+            score_weights[d + 1] = score_weights[d] + (d > 0 ? 1/(double)pow(d,optimized_params.first) : 1);
+	    }
 	}
 
-	/* function to calculate a block score given a writing sequence and base index to
-	 * search from. the block score is calculated by taking into account the age of all
-	 * pages in the block. for full description of the function logic, parameter adjustment
-	 * experiments and graph results - please see written report
+	/* function to calculate a block score given a base index to search from (the current write).
+	 * the block score is calculated by taking into account the age of all pages in the block:
+	 * for every future write d (up to T*Z writes ahead) we add (number of pages in the block that were
+	 * not overwritten yet)/d^n. a page that is next overwritten t writes from now therefore adds
+	 * score_weights[t] to the score, so the score is computed from the next write of every page in O(Z).
+	 * for full description of the function logic, parameter adjustment experiments and graph results -
+	 * please see written report
 	 */
-	double getBlockScore(int block_num, unsigned long long base_index, unsigned int* writing_sequence) const{
+	double getBlockScore(int block_num, unsigned long long base_index) const{
         assert(block_num >= 0);
-	    Block* curr_block = blocks[block_num];
-        set<int> pages_in_block;
-        for (int i = 0; i < PAGES_PER_BLOCK; ++i) {
-            if (curr_block->pages[i].logicalPage){
-                pages_in_block.insert(getLogicalPageNumber(curr_block->pages[i].logicalPage));
-            }
-        }
+        assert(lookahead_index);
+	    Block* curr_block = &blocks[block_num];
 
-        double block_score = 0;
-        //TODO: should we scan until i < NUMBER_OF_PAGES or until i < base_index + PAGES_PER_BLOCK*LOGICAL_BLOCK_NUMBER ?
-        for (unsigned long long i = base_index ; i < base_index + PAGES_PER_BLOCK*PHYSICAL_BLOCK_NUMBER && i < NUMBER_OF_PAGES ; i++){
-            if (pages_in_block.find(writing_sequence[i]) != pages_in_block.end()){
-                pages_in_block.erase(writing_sequence[i]);
-                if (pages_in_block.empty()){
-                    return block_score;
-                }
+        unsigned long long horizon = std::min((unsigned long long)geometry.pages_per_block*geometry.physical_blocks,
+                                              geometry.number_of_pages - base_index);
+        return kernels->blockScore(curr_block->pages, curr_block->validBitmap, geometry.pages_per_block,
+                                   lookahead_index->next_write, score_weights.data(), base_index, horizon);
+	}
+
+	/* the scores of several blocks at once: (*scores)[i] is getBlockScore(block_nums[i], base_index). the blocks
+	 * are scored SCORE_BATCH_LANES at a time by the batch kernel, so scoring a set of candidate blocks costs about
+	 * one scan of their pages instead of one chain of dependent additions per block. a batch of less than
+	 * SCORE_BATCH_LANES / 2 blocks (the rest of the set, or a set of a few blocks) is not worth the gather, and is
+	 * scored one block at a time (the scores are the same).
+	 */
+	void getBlockScores(const vector<int>& block_nums, unsigned long long base_index, vector<double>* scores) const{
+        scores->resize(block_nums.size());
+        getBlockScores(block_nums.data(), block_nums.size(), base_index, scores->data(), scoreDistances(0));
+	}
+
+	/* scores[i] = getBlockScore(block_nums[i], base_index) for 0<=i<count. distances is the scratch buffer of the
+	 * kernel (see scoreDistances)
+	 */
+	void getBlockScores(const int* block_nums, unsigned int count, unsigned long long base_index, double* scores,
+	                    unsigned int* distances) const{
+        assert(lookahead_index);
+        unsigned long long horizon = std::min((unsigned long long)geometry.pages_per_block*geometry.physical_blocks,
+                                              geometry.number_of_pages - base_index);
+        unsigned int first = 0;
+        const uint32_t* pages[SCORE_BATCH_LANES];
+        const uint64_t* bitmaps[SCORE_BATCH_LANES];
+        while (first + SCORE_BATCH_LANES / 2 <= count) {
+            int lanes = std::min((int)(count - first), SCORE_BATCH_LANES);
+            for (int lane = 0; lane < lanes; lane++) {
+                assert(block_nums[first + lane] >= 0);
+                pages[lane] = blocks[block_nums[first + lane]].pages;
+                bitmaps[lane] = blocks[block_nums[first + lane]].validBitmap;
             }
-            // TODO: adjust the block score function.
-            long long div_value = i - base_index;
-            block_score += div_value > 0 ? (pages_in_block.size()/(double)pow(div_value,optimized_params.first)) : pages_in_block.size();
+            kernels->blockScores(pages, bitmaps, lanes, geometry.pages_per_block, lookahead_index->next_write,
+                                 score_weights.data(), base_index, horizon, distances, scores + first);
+            first += lanes;
+        }
+        for (; first < count; first++) {
+            scores[first] = getBlockScore(block_nums[first], base_index);
         }
-        return block_score;
 	}
 
     #define X(lower_bound, upper_bound, i_val) \
@@ -409,7 +733,7 @@ public:
          * */
         int getOptimizedAlphaValParam()
         {
-            float OP = (float)(PHYSICAL_BLOCK_NUMBER-LOGICAL_BLOCK_NUMBER)/LOGICAL_BLOCK_NUMBER;
+            float OP = geometry.overProvisioning();
             ALGO_PARAMS_TABLE
             return -1; // shouldn't get here
         }
@@ -417,70 +741,139 @@ public:
     #undef X
 
 
-    Block* getBestBlockToEvict(unsigned int* writing_sequence, long long base_index) const {
+    /* the score of a victim candidate: its block score, less the largest page weight (a page that is not
+     * overwritten within the horizon) for every valid page it has beyond Y. up to a constant, this is minus the sum
+     * of score_weights[horizon] - score_weights[t] over the valid pages: a page that is overwritten soon (small t)
+     * costs a lot, a page that lives on costs little. a block with Y+1 valid pages therefore beats a block with Y
+     * valid pages that are about to die. in the Y bucket it is the block score.
+     * a larger penalty makes the blocks beyond Y lose almost always, a smaller one lets them win too often
+     * (tuned on uniform and hot/cold workloads, T=64 U=50 and T=256 U=200 with Z=32).
+     * the penalty does not count the copies themselves, only candidate_depth bounds them: a deep search finds
+     * blocks full of long lived pages, relocates them all and raises the WA above depth 0 (e.g depth 16 at T=64
+     * U=50 Z=32, or depth 8 at Z=16 and Z=64). depths up to MAX_CANDIDATE_DEPTH were at or below depth 0 for
+     * Z=16, 32 and 64, so the depth is capped there
+     */
+    double candidateScore(int block_num, double block_score, double max_weight) const{
+        return block_score - (blocks[block_num].valid - Y) * max_weight;
+    }
 
-        vector<pair<int, double>> block_scores;
+    /* the best of count candidates: (candidateScore, index). the first one wins ties. only SCORE_CHUNK_BLOCKS
+     * scores are kept at a time, whatever the number of candidates is. distances is the scratch buffer of the
+     * kernel (see scoreDistances)
+     */
+    pair<double, unsigned int> bestCandidate(const int* block_nums, unsigned int count, unsigned long long base_index,
+                                             unsigned int* distances) const{
+        unsigned long long horizon = std::min((unsigned long long)geometry.pages_per_block*geometry.physical_blocks,
+                                              geometry.number_of_pages - base_index);
+        double max_weight = score_weights[horizon];
+        pair<double, unsigned int> best(0, 0);
+        double scores[SCORE_CHUNK_BLOCKS];
+        for (unsigned int first = 0; first < count; first += SCORE_CHUNK_BLOCKS) {
+            unsigned int chunk = std::min(count - first, (unsigned int)SCORE_CHUNK_BLOCKS);
+            getBlockScores(block_nums + first, chunk, base_index, scores, distances);
+            for (unsigned int i = 0; i < chunk; i++) {
+                double score = candidateScore(block_nums[first + i], scores[i], max_weight);
+                if (first + i == 0 || score > best.first){
+                    best = pair<double, unsigned int>(score, first + i);
+                }
+            }
+        }
+        return best;
+    }
 
-        // TOOD: adjust k
-        /* the k parameter is adjustable and will decide the number of blocks to examine for each GC */
-        for (int k = Y; k <= Y and k < PAGES_PER_BLOCK; k++) {
-            for (int block_num : V[k]){
-                assert(block_num >= 0);
-                double score = getBlockScore(block_num, base_index, writing_sequence);
-                block_scores.emplace_back(pair<int, double>{block_num, score});
+    /* the victim of greedy_lookahead: the candidate with the best candidateScore. the candidates are the full
+     * blocks of V[Y], ..., V[Y + candidate_depth] (never the blocks with no obsolete page), lowest bucket first and
+     * at most candidate_blocks of them (0 - no limit). with score_pool, a large set is split between its threads
+     * and each thread keeps only the best of its share, so a deeper search adds scoring work but no sort, and the
+     * threads share it. the choice does not depend on the number of threads.
+     */
+    Block* getBestBlockToEvict(unsigned long long base_index) const {
+        assert(candidate_depth >= 0 && candidate_depth <= MAX_CANDIDATE_DEPTH);
+
+        vector<int> candidates;
+        for (int k = Y; k <= Y + candidate_depth && k < geometry.pages_per_block; k++) {
+            for (int block_num : V.bucket(k)){
+                if (candidate_blocks > 0 && (int)candidates.size() == candidate_blocks){
+                    break;
+                }
+                candidates.push_back(block_num);
             }
         }
 
-        /* sort blocks in descending order by block score */
-        std::sort(block_scores.begin(),block_scores.end(),[] (const pair<int,double>& l_val, const pair<int,double>& r_val) {
-            return l_val.second > r_val.second;
-        });
-	    return blocks[block_scores.front().first];
+        unsigned int count = candidates.size();
+        unsigned int tasks = score_pool ? std::min((unsigned int)score_pool->size(), count / SCORE_PARALLEL_MIN_BLOCKS) : 1;
+        if (tasks < 2){
+            return &blocks[candidates[bestCandidate(candidates.data(), count, base_index, scoreDistances(0)).second]];
+        }
+        vector<pair<double, unsigned int>> bests(tasks);
+        for (unsigned int task = 0; task < tasks; task++) {
+            score_pool->submit([this, &candidates, &bests, count, tasks, task, base_index] {
+                unsigned int first = (unsigned long long)count * task / tasks;
+                unsigned int last = (unsigned long long)count * (task + 1) / tasks;
+                bests[task] = bestCandidate(candidates.data() + first, last - first, base_index,
+                                            scoreDistances(task + 1));
+                bests[task].second += first;
+            });
+        }
+        score_pool->wait();
+        /* the shares are in candidate order, so the first best share has the first best candidate */
+        pair<double, unsigned int> best = bests[0];
+        for (unsigned int task = 1; task < tasks; task++) {
+            if (bests[task].first > best.first){
+                best = bests[task];
+            }
+        }
+	    return &blocks[candidates[best.second]];
 	}
 
 	int updateMinValid(){
-        int minValid = 0;
-        while (V[minValid].size() == 0 && minValid <= PAGES_PER_BLOCK) {
-            minValid++;
-        }
+        int minValid = V.minValid();
 
-        if (minValid > PAGES_PER_BLOCK) {
+        if (minValid > geometry.pages_per_block) {
             return NA;
         }
         Y = minValid;
         return minValid;
 	}
 
-	Block* minBlockWithLookAhead(unsigned int* writing_sequence, long long base_index){
+	Block* minBlockWithLookAhead(unsigned long long base_index){
+        PROFILE_SCOPE(PROFILE_VICTIM_SELECTION);
         updateMinValid();
         /* if we have blocks with no valid pages, pick one at random (all are
          * equally good)
          */
         if (Y == 0){
-            return blocks[*(V[Y].begin())];
+            return &blocks[V.front(Y)];
         }
-        return getBestBlockToEvict(writing_sequence, base_index);
+        return getBestBlockToEvict(base_index);
 	}
 
-	void updateObsolete(Block* block) const {
+	void updateObsolete(Block* block) {
 		if (block->nextFree == BLOCK_FULL) {
-            int valid = block->valid;
-            V[valid + 1].erase(block->blockNo);
-            V[valid].insert(block->blockNo);
+            PROFILE_COUNT(PROFILE_BUCKET_MOVES, 1);
+            V.move(block->blockNo, block->valid);
+            if (oracle){
+                oracle->update(block->blockNo, oracleKey(block));
+            }
         }
 
 	}
 
-	void copyValidToNewPlace(char* data, LogicalPage* logicalPages[],
+	void copyValidToNewPlace(char* data, unsigned int logicalPages[],
                              int counter, Block* to) {
 		Block* current = to;
 		int result;
 		for (int i = 0; i < counter; i++) {
-			logicalPages[i]->clear();
-			result = current->write(data + i * PAGE_SIZE, logicalPages[i]);
+			result = current->write(data + i * geometry.page_size, logicalPages[i]);
 			physicalPageWrites++;
+			if (oracle) {
+				oracle->dying[current->blockNo] += isDying(logicalPages[i]);
+			}
 			if (result == BLOCK_FULL) {
-				V[current->valid].insert(current->blockNo);
+				V.insert(current->blockNo, current->valid);
+				if (oracle) {
+					oracle->insert(current->blockNo, oracleKey(current));
+				}
 				freeList.pop_front();
 				current = freeList.front();
 			}
@@ -488,26 +881,24 @@ public:
 	}
 
 	void blockClean(Block* block) {
-		char tempData[PAGES_PER_BLOCK * PAGE_SIZE];
-		LogicalPage* logicalPages[PAGES_PER_BLOCK];
+		PROFILE_SCOPE(PROFILE_BLOCK_CLEAN);
+		char tempData[geometry.pages_per_block * geometry.page_size];
+		unsigned int logicalPages[geometry.pages_per_block];
 		int counter;
 		Block* current = freeList.front();
-		Block temp;
 
 		block->copyValidToTempAndClean(tempData, logicalPages, &counter);
+		PROFILE_COUNT(PROFILE_BLOCK_CLEANS, 1);
+		PROFILE_COUNT(PROFILE_RELOCATED_PAGES, counter);
 		copyValidToNewPlace(tempData, logicalPages, counter, current);
 	}
 
-	void print() {
-		cout << erases << "\t\t" << logicalPageWrites << "\t\t" << Y << "\t";
-		for (int i = 0; i < PAGES_PER_BLOCK + 1; i++) {
-			cout << V[i].size() << "\t";
-		}
-
-		cout << endl;
+	void record() {
+		recorder->record(erases, logicalPageWrites, Y, V);
 	}
 
 	void GC() {
+		PROFILE_SCOPE(PROFILE_GC);
 
 		Block* min = minBlock();
 		assert(min);
@@ -515,79 +906,203 @@ public:
 //		assert(min->valid == choseMinValidOld()->valid);
 
 		erases++;
-		if (print_mode){
-            print();
+		if (recorder){
+            record();
         }
 
 		freeList.push_back(min);
 		assert(!freeList.empty());
-		V[min->valid].erase(min->blockNo);
+		V.erase(min->blockNo);
 		blockClean(min);
 
 	}
 
 	void printV() {
 	    cout<<"blocks status:"<<endl;
-        for (int i = 0; i < PAGES_PER_BLOCK+1; i++) {
+        for (int i = 0; i < geometry.pages_per_block+1; i++) {
             cout<<"V["<<i<<"]: ";
-            for (int j : V[i]){
+            for (int j : V.bucket(i)){
                 cout<<j<<" ";
             }
             cout<<endl;
         }
 	}
 
-    void GCWithLookAhead(unsigned int* writing_sequence, unsigned int base_index) {
+    void GCWithLookAhead(unsigned long long base_index) {
+        PROFILE_SCOPE(PROFILE_GC);
 
-        Block* min = minBlockWithLookAhead(writing_sequence, base_index);
+        Block* min = minBlockWithLookAhead(base_index);
 
         assert(min);
 
 //		assert(min->valid == choseMinValidOld()->valid);
 
         erases++;
-        if (print_mode){
-            print();
+        if (recorder){
+            record();
         }
 
         freeList.push_back(min);
         assert(!freeList.empty());
-        V[min->valid].erase(min->blockNo);
+        V.erase(min->blockNo);
         blockClean(min);
     }
 
 
-    void updateMappingTable(unsigned int lpn, Block* current) const{
-        Block *obsoletePlace =
-                blocks[mappingTable[lpn].physicalPage->blockNo];
-        obsoletePlace->obsolete(mappingTable[lpn].physicalPage);
+    void GCWithOracle() {
+        PROFILE_SCOPE(PROFILE_GC);
+
+        Block* min = oracleVictim();
+
+        assert(min);
+
+        erases++;
+        if (recorder){
+            record();
+        }
+
+        freeList.push_back(min);
+        assert(!freeList.empty());
+        V.erase(min->blockNo);
+        oracle->erase(min->blockNo);
+        /* all the valid pages of the victim are relocated */
+        oracle->dying[min->blockNo] = 0;
+        blockClean(min);
+    }
+
+    /* is the next write of a logical page within the lookahead horizon */
+    bool isDying(unsigned int lpn) const{
+        return lookahead_index->next_write[lpn] < oracle_end;
+    }
+
+    /* the oracle key of a full block, the smaller the better a victim: the pages that would be relocated, plus
+     * the ones among them that are overwritten within the oracle horizon. relocating those is a wasted write,
+     * since the block loses them by itself if it is left alone for a while. a block with no obsolete page
+     * frees nothing, so it comes after all the others (whose keys are at most 2Z-2)
+     */
+    long long oracleKey(const Block* block) const{
+        if (block->valid == geometry.pages_per_block){
+            return 2 * geometry.pages_per_block;
+        }
+        return block->valid + oracle->dying[block->blockNo];
+    }
+
+    /* the oracle horizon: half of the over provisioned pages, (T-U)*Z/2 writes (at most the lookahead horizon).
+     * with the whole lookahead horizon (T*Z) most pages of a uniform workload count as dying and the counts
+     * hardly tell the blocks apart; half of the over provisioning gave the lowest WA on uniform and hot/cold
+     * workloads over a range of T, U and Z
+     */
+    unsigned long long oracleHorizon() const{
+        unsigned long long horizon = (unsigned long long)(geometry.physical_blocks - geometry.logical_blocks) *
+                                     geometry.pages_per_block / 2;
+        return std::max(std::min(horizon, lookahead_index->horizon), 1ULL);
+    }
+
+    /* build the oracle from the current state: the dying pages of every block and the heap of the full blocks */
+    void buildOracle(unsigned long long base_index){
+        assert(lookahead_index);
+        oracle = new OracleQueue(geometry.physical_blocks, oracleHorizon());
+        oracle_end = std::min(base_index + oracle->horizon, lookahead_index->frontier);
+        for (int i = 0; i < geometry.physical_blocks; i++) {
+            Block* block = &blocks[i];
+            block->forEachValid([this, block](int page_no) {
+                oracle->dying[block->blockNo] += isDying(block->pages[page_no]);
+            });
+            if (V.contains(i)){
+                oracle->insert(i, oracleKey(block));
+            }
+        }
+    }
+
+    /* the positions added to the lookahead index since the last write: a page whose next write is one of them
+     * was not written within the horizon before, so it is dying now
+     */
+    void extendOracle(unsigned long long base_index){
+        unsigned long long end = std::min(base_index + oracle->horizon, lookahead_index->frontier);
+        for (; oracle_end < end; oracle_end++) {
+            unsigned int lpn = lookahead_index->writing_sequence->at(oracle_end);
+            if (lookahead_index->next_write[lpn] == oracle_end && mappingTable[lpn] != UNMAPPED_PAGE){
+                Block* block = getBlockOfPage(mappingTable[lpn]);
+                oracle->dying[block->blockNo]++;
+                if (oracle->contains(block->blockNo)){
+                    oracle->update(block->blockNo, oracleKey(block));
+                }
+            }
+        }
+    }
+
+    void dropOracle(){
+        delete oracle;
+        oracle = nullptr;
+    }
+
+    Block* oracleVictim(){
+        PROFILE_SCOPE(PROFILE_VICTIM_SELECTION);
+        updateMinValid();
+        return &blocks[oracle->top()];
+    }
+
+    /* get the block that holds a physical page */
+    Block* getBlockOfPage(uint32_t ppn) const{
+        return &blocks[ppn / geometry.pages_per_block];
+    }
+
+    void updateMappingTable(unsigned int lpn, Block* current) {
+        PROFILE_SCOPE(PROFILE_MAPPING_UPDATE);
+        uint32_t ppn = mappingTable[lpn];
+        Block *obsoletePlace = getBlockOfPage(ppn);
+        obsoletePlace->obsolete(ppn % geometry.pages_per_block);
+        if (oracle){
+            oracle->dying[obsoletePlace->blockNo] -= isDying(lpn);
+        }
         if (obsoletePlace != current) {
             updateObsolete(obsoletePlace);
         }
-        mappingTable[lpn].clear();
+        mappingTable[lpn] = UNMAPPED_PAGE;
 	}
 
-	void write(char* data, unsigned int lpn , Algorithm algorithm , unsigned int* writing_sequence = nullptr,unsigned long long base_index = NA ) {
+	void write(char* data, unsigned int lpn , Algorithm algorithm , unsigned long long base_index = NA ) {
+        if (algorithm == ORACLE){
+            if (!oracle){
+                buildOracle(base_index);
+            }
+            extendOracle(base_index);
+        }
+        else if (oracle){
+            dropOracle();
+        }
         if (freeList.empty()){
             if (algorithm == GREEDY){
                 GC();
             }
+            else if (algorithm == ORACLE){
+                GCWithOracle();
+            }
             else {
-                GCWithLookAhead(writing_sequence,base_index);
+                GCWithLookAhead(base_index);
             }
         }
         Block *current = freeList.front();
 
-        if (mappingTable[lpn].status != FREE_LOGICAL) {
+        if (mappingTable[lpn] != UNMAPPED_PAGE) {
             updateMappingTable(lpn,current);
         }
 
-        int result = current->write(data, &(mappingTable[lpn]));
+        int result = current->write(data, lpn);
         physicalPageWrites++;
-        assert(current->valid<= PAGES_PER_BLOCK);
+        assert(current->valid<= geometry.pages_per_block);
+        if (oracle){
+            /* the index moves past this write right after it, so the new copy is dying if the page is written
+             * again after base_index */
+            oracle->dying[current->blockNo] +=
+                    lookahead_index->nextOccurrence(base_index) < oracle_end;
+        }
 
         if (result == BLOCK_FULL) {
-            V[current->valid].insert(current->blockNo);
+            V.insert(current->blockNo, current->valid);
+            if (oracle){
+                oracle->insert(current->blockNo, oracleKey(current));
+            }
             freeList.pop_front();
         }
 
@@ -603,25 +1118,25 @@ public:
 		gen_blocks.at(generation) = block_to_assign;
 	}
 
-    void writeGenerational(char* data, unsigned int lpn, int generation, unsigned int* writing_sequence, unsigned long long base_index) {
+    void writeGenerational(char* data, unsigned int lpn, int generation, unsigned long long base_index) {
         Block* gen_block = getGenerationalBlock(generation);
         if (!gen_block){
             if (freeList.empty()){
-                GCWithLookAhead(writing_sequence,base_index);
+                GCWithLookAhead(base_index);
             }
             gen_block = freeList.front();
             updateGenBlock(generation,gen_block);
             freeList.pop_front();
         }
-        if (mappingTable[lpn].status != FREE_LOGICAL) {
+        if (mappingTable[lpn] != UNMAPPED_PAGE) {
             updateMappingTable(lpn, gen_block);
         }
-        int result = gen_block->write(data, &(mappingTable[lpn]));
+        int result = gen_block->write(data, lpn);
         physicalPageWrites++;
-        assert(gen_block->valid <= PAGES_PER_BLOCK);
+        assert(gen_block->valid <= geometry.pages_per_block);
 
         if (result == BLOCK_FULL) {
-            V[gen_block->valid].insert(gen_block->blockNo);
+            V.insert(gen_block->blockNo, gen_block->valid);
             updateGenBlock(generation,nullptr);
         }
         logicalPageWrites++;
@@ -632,24 +1147,16 @@ public:
      * This implementation better fits the theoretical model of the GC as learned in class
      */
     void NewBlockClean(Block* block) {
-        char data[PAGE_SIZE];
-        LogicalPage *logicalPages[PAGES_PER_BLOCK];
-        int counter = 0;
-        for (int i = 0; i < PAGES_PER_BLOCK; i++) {
-            if (block->pages[i].status == VALID) {
-                //read(data + (*counter) * PAGE_SIZE, pages[i].logicalPage);
-                logicalPages[counter] = block->pages[i].logicalPage;
-                counter++;
-            }
-            block->pages[i].status = FREE_PHYSICAL;
-            block->pages[i].logicalPage = nullptr;
-        }
-        block->valid = 0;
-        block->nextFree = 0;
+        PROFILE_SCOPE(PROFILE_BLOCK_CLEAN);
+        char data[geometry.page_size];
+        unsigned int logicalPages[geometry.pages_per_block];
+        int counter = kernels->collectValid(block->pages, block->validBitmap, geometry.pages_per_block, logicalPages);
+        block->clean();
+        PROFILE_COUNT(PROFILE_BLOCK_CLEANS, 1);
+        PROFILE_COUNT(PROFILE_RELOCATED_PAGES, counter);
 
         /* rewrite valid pages to block */
         for (int i = 0; i < counter; i++) {
-            logicalPages[i]->clear();
             block->write(data, logicalPages[i]);
             physicalPageWrites++;
         }
@@ -659,8 +1166,8 @@ public:
      * if the block is full we preform a block clean and then write the page
      */
     void writeToBlock(char* data, int lpn, int block_number){
-	    Block* write_to = blocks[block_number];
-	    while (write_to->nextFree == BLOCK_FULL && write_to->valid == PAGES_PER_BLOCK){
+	    Block* write_to = &blocks[block_number];
+	    while (write_to->nextFree == BLOCK_FULL && write_to->valid == geometry.pages_per_block){
 	        // error - should not get here. but if we got here we resort to greedy lookahead algorithm.
 	        cout<<"block full! wanted to write page number "<<lpn<<" to block: "<<block_number<<endl;
 	        write(data,lpn,GREEDY_LOOKAHEAD);
@@ -669,24 +1176,24 @@ public:
 
 	    if (write_to->nextFree == BLOCK_FULL){
             erases++;
-            if (print_mode){
-                print();
+            if (recorder){
+                record();
             }
 
             freeList.push_back(write_to); // after cleaning this block will have free pages
-            V[write_to->valid].erase(write_to->blockNo);
+            V.erase(write_to->blockNo);
             NewBlockClean(write_to);
 	    }
 
-        if (mappingTable[lpn].status != FREE_LOGICAL) {
+        if (mappingTable[lpn] != UNMAPPED_PAGE) {
             updateMappingTable(lpn,write_to);
         }
 
-        int result = write_to->write(data, &(mappingTable[lpn]));
+        int result = write_to->write(data, lpn);
         physicalPageWrites++;
 
         if (result == BLOCK_FULL) {
-            V[write_to->valid].insert(write_to->blockNo);
+            V.insert(write_to->blockNo, write_to->valid);
             freeList.remove(write_to); // delete block from freelist (must be there)
         }
 
@@ -695,12 +1202,12 @@ public:
 
     /* deletes all blocks with Z invalid pages, i.e all the block is invalid. */
     void sweepFullBlocks(){
-        for (int i = 0 ; i < PHYSICAL_BLOCK_NUMBER ; i++){
-            if (blocks[i]->nextFree == BLOCK_FULL && blocks[i]->valid == 0){
+        for (int i = 0 ; i < geometry.physical_blocks ; i++){
+            if (blocks[i].nextFree == BLOCK_FULL && blocks[i].valid == 0){
                 erases++;
-                V[blocks[i]->valid].erase(blocks[i]->blockNo);
-                freeList.push_front(blocks[i]);
-                NewBlockClean(blocks[i]);
+                V.erase(blocks[i].blockNo);
+                freeList.push_front(&blocks[i]);
+                NewBlockClean(&blocks[i]);
             }
         }
     }
@@ -708,28 +1215,28 @@ public:
     /* this should used for debugging purposes only. use with small block numbers */
     void printMemoryLayout() const{
         cout<<"       ";
-        for (int i = 0; i < PHYSICAL_BLOCK_NUMBER; ++i) {
+        for (int i = 0; i < geometry.physical_blocks; ++i) {
             cout<<i<<"    "; // block number
         }
         cout<<endl;
         cout<<"     ";
-        for (int i = 0; i < PHYSICAL_BLOCK_NUMBER; ++i) {
+        for (int i = 0; i < geometry.physical_blocks; ++i) {
             cout<<"-----";
         }
         cout<<endl;
 
-        for (int i = 0; i < PAGES_PER_BLOCK; ++i) {
+        for (int i = 0; i < geometry.pages_per_block; ++i) {
             cout<<i<<"   |"; // page number
-            for (int j = 0; j < PHYSICAL_BLOCK_NUMBER; ++j) {
-                if(blocks[j]->pages[i].status == OBSOLETE){
+            for (int j = 0; j < geometry.physical_blocks; ++j) {
+                PhysicalPageStatus status = blocks[j].pageStatus(i);
+                if(status == OBSOLETE){
                     cout<<" X  |";
                 }
-                if(blocks[j]->pages[i].status == FREE_PHYSICAL){
+                if(status == FREE_PHYSICAL){
                     cout<<"    |";
                 }
-                if(blocks[j]->pages[i].status == VALID){
-                    LogicalPage* logical_page = blocks[j]->pages[i].logicalPage;
-                    int k = getLogicalPageNumber(logical_page);
+                if(status == VALID){
+                    int k = blocks[j].pages[i];
                     if (k/10 == 0){
                         cout<<"  "<<k<<" |";
                     }
@@ -739,7 +1246,7 @@ public:
                 }
             }
             cout<<endl<<"     ";
-            for (int j = 0; j < PHYSICAL_BLOCK_NUMBER; ++j) {
+            for (int j = 0; j < geometry.physical_blocks; ++j) {
                 cout<<"-----";
             }
             cout<<endl;
@@ -748,23 +1255,233 @@ public:
 
 	/* get the number of valid page writes in a given block */
     int getValidWritesInBlock(int block_num) const{
-        Block* curr_block = blocks[block_num];
-        int valid_writes = 0;
-        for (int i = 0; i < PAGES_PER_BLOCK; ++i) {
-            if (curr_block->pages[i].logicalPage){
-                valid_writes++;
-            }
-        }
-        return valid_writes;
+        return blocks[block_num].countValid();
 	}
 
 
 	void read(char* buffer, int lpn) {
-		if (mappingTable[lpn].status == FREE_LOGICAL) {
+		if (mappingTable[lpn] == UNMAPPED_PAGE) {
 			return;
 		}
-		blocks[mappingTable[lpn].physicalPage->blockNo]->read(buffer,
-				&mappingTable[lpn]);
+		getBlockOfPage(mappingTable[lpn])->read(buffer, lpn);
+	}
+
+	/* fork the FTL: a new FTL in exactly the same state (same tables, same block orders in V and in the free
+	 * list, same counters), sharing the lookahead index. used to run several algorithms from one steady state.
+	 */
+	FTL* clone() const {
+		FTL* copy = new FTL(geometry);
+		copy->copyStateFrom(*this);
+		return copy;
+	}
+
+	/* make this FTL a copy of other. both must have the same geometry */
+	void copyStateFrom(const FTL& other) {
+		assert(geometry.physical_blocks == other.geometry.physical_blocks);
+		assert(geometry.logical_blocks == other.geometry.logical_blocks);
+		assert(geometry.pages_per_block == other.geometry.pages_per_block);
+		memcpy(mappingTable, other.mappingTable, geometry.logicalPages() * sizeof(uint32_t));
+		memcpy(reverseMappingTable, other.reverseMappingTable, geometry.physicalPages() * sizeof(uint32_t));
+		memcpy(validBitmapArena, other.validBitmapArena,
+				geometry.physical_blocks * geometry.bitmapWords() * sizeof(uint64_t));
+		for (int i = 0; i < geometry.physical_blocks; i++) {
+			blocks[i].valid = other.blocks[i].valid;
+			blocks[i].nextFree = other.blocks[i].nextFree;
+			if (V.contains(i)) {
+				V.erase(i);
+			}
+		}
+		for (int k = 0; k <= geometry.pages_per_block; k++) {
+			for (int block_num : other.V.bucket(k)) {
+				V.insert(block_num, k);
+			}
+		}
+		freeList.clear();
+		for (Block* block : other.freeList) {
+			freeList.push_back(&blocks[block->blockNo]);
+		}
+		gen_blocks.clear();
+		for (auto& gen_block : other.gen_blocks) {
+			gen_blocks[gen_block.first] = gen_block.second ? &blocks[gen_block.second->blockNo] : nullptr;
+		}
+		Y = other.Y;
+		erases = other.erases;
+		erases_steady = other.erases_steady;
+		logicalPageWrites = other.logicalPageWrites;
+		logicalPageWritesSteady = other.logicalPageWritesSteady;
+		physicalPageWrites = other.physicalPageWrites;
+		physicalPageWritesSteady = other.physicalPageWritesSteady;
+		optimized_params = other.optimized_params;
+		lookahead_index = other.lookahead_index;
+		score_weights = other.score_weights;
+		candidate_depth = other.candidate_depth;
+		candidate_blocks = other.candidate_blocks;
+		setScorePool(other.score_pool);
+		dropOracle();
+	}
+
+	/* save the full state of the FTL to a binary snapshot file: the mapping tables, the valid bitmaps, the
+	 * valid/nextFree of every block, the order of the blocks in every V bucket and in the free list, the
+	 * generation blocks and the counters. the orders are kept so a loaded FTL makes exactly the same choices
+	 * as the saved one. returns false on I/O errors.
+	 */
+	bool saveSnapshot(const char* path) const {
+		FILE* file = fopen(path, "wb");
+		if (!file) {
+			return false;
+		}
+		char magic[8] = SNAPSHOT_MAGIC;
+		int header[] = {SNAPSHOT_VERSION, geometry.physical_blocks, geometry.logical_blocks,
+				geometry.pages_per_block};
+		fwrite(magic, sizeof(magic), 1, file);
+		fwrite(header, sizeof(header), 1, file);
+
+		fwrite(mappingTable, sizeof(uint32_t), geometry.logicalPages(), file);
+		fwrite(reverseMappingTable, sizeof(uint32_t), geometry.physicalPages(), file);
+		fwrite(validBitmapArena, sizeof(uint64_t), geometry.physical_blocks * geometry.bitmapWords(), file);
+		for (int i = 0; i < geometry.physical_blocks; i++) {
+			int block_state[] = {blocks[i].valid, blocks[i].nextFree};
+			fwrite(block_state, sizeof(block_state), 1, file);
+		}
+
+		/* V bucket by bucket, then the free list */
+		for (int k = 0; k <= geometry.pages_per_block; k++) {
+			vector<Block*> bucket;
+			for (int block_num : V.bucket(k)) {
+				bucket.push_back(&blocks[block_num]);
+			}
+			writeBlockList(file, bucket);
+		}
+		writeBlockList(file, vector<Block*>(freeList.begin(), freeList.end()));
+
+		/* generation blocks: (generation, block number or NA) */
+		int number_of_generations = gen_blocks.size();
+		fwrite(&number_of_generations, sizeof(number_of_generations), 1, file);
+		for (auto& gen_block : gen_blocks) {
+			int entry[] = {gen_block.first, gen_block.second ? gen_block.second->blockNo : NA};
+			fwrite(entry, sizeof(entry), 1, file);
+		}
+
+		unsigned long long counters[] = {erases, erases_steady, logicalPageWrites, logicalPageWritesSteady,
+				physicalPageWrites, physicalPageWritesSteady};
+		fwrite(counters, sizeof(counters), 1, file);
+		fwrite(&Y, sizeof(Y), 1, file);
+
+		bool ok = !ferror(file);
+		return fclose(file) == 0 && ok;
+	}
+
+	/* restore the state saved by saveSnapshot. the snapshot must have been saved from an FTL with the same T, U
+	 * and Z. returns false if the file can not be read or does not match the geometry. the whole snapshot is read
+	 * before any of the state is replaced, so the FTL is left untouched when it returns false.
+	 */
+	bool loadSnapshot(const char* path) {
+		FILE* file = fopen(path, "rb");
+		if (!file) {
+			return false;
+		}
+		char magic[8];
+		int header[4];
+		if (fread(magic, sizeof(magic), 1, file) != 1 || fread(header, sizeof(header), 1, file) != 1
+				|| memcmp(magic, SNAPSHOT_MAGIC, sizeof(magic)) != 0 || header[0] != SNAPSHOT_VERSION
+				|| header[1] != geometry.physical_blocks || header[2] != geometry.logical_blocks
+				|| header[3] != geometry.pages_per_block) {
+			fclose(file);
+			return false;
+		}
+
+		vector<uint32_t> mapping(geometry.logicalPages());
+		vector<uint32_t> reverse_mapping(geometry.physicalPages());
+		vector<uint64_t> valid_bitmaps(geometry.physical_blocks * geometry.bitmapWords());
+		vector<int> block_states(2 * geometry.physical_blocks);
+		bool ok = fread(mapping.data(), sizeof(uint32_t), mapping.size(), file) == mapping.size()
+				&& fread(reverse_mapping.data(), sizeof(uint32_t), reverse_mapping.size(), file) == reverse_mapping.size()
+				&& fread(valid_bitmaps.data(), sizeof(uint64_t), valid_bitmaps.size(), file) == valid_bitmaps.size()
+				&& fread(block_states.data(), sizeof(int), block_states.size(), file) == block_states.size();
+
+		vector<vector<Block*>> buckets(geometry.pages_per_block + 1);
+		for (int k = 0; ok && k <= geometry.pages_per_block; k++) {
+			ok = readBlockList(file, &buckets[k]);
+		}
+		vector<Block*> free_blocks;
+		ok = ok && readBlockList(file, &free_blocks);
+
+		int number_of_generations = 0;
+		ok = ok && fread(&number_of_generations, sizeof(number_of_generations), 1, file) == 1;
+		map<int, Block*> generations;
+		for (int i = 0; ok && i < number_of_generations; i++) {
+			int entry[2];
+			ok = fread(entry, sizeof(entry), 1, file) == 1
+					&& (entry[1] == NA || (entry[1] >= 0 && entry[1] < geometry.physical_blocks));
+			if (ok) {
+				generations[entry[0]] = entry[1] == NA ? nullptr : &blocks[entry[1]];
+			}
+		}
+
+		unsigned long long counters[6];
+		int y;
+		ok = ok && fread(counters, sizeof(counters), 1, file) == 1 && fread(&y, sizeof(y), 1, file) == 1;
+		fclose(file);
+		if (!ok) {
+			return false;
+		}
+
+		/* every read succeeded, replace the state */
+		memcpy(mappingTable, mapping.data(), mapping.size() * sizeof(uint32_t));
+		memcpy(reverseMappingTable, reverse_mapping.data(), reverse_mapping.size() * sizeof(uint32_t));
+		memcpy(validBitmapArena, valid_bitmaps.data(), valid_bitmaps.size() * sizeof(uint64_t));
+		for (int i = 0; i < geometry.physical_blocks; i++) {
+			blocks[i].valid = block_states[2 * i];
+			blocks[i].nextFree = block_states[2 * i + 1];
+			if (V.contains(i)) {
+				V.erase(i);
+			}
+		}
+		for (int k = 0; k <= geometry.pages_per_block; k++) {
+			for (Block* block : buckets[k]) {
+				V.insert(block->blockNo, k);
+			}
+		}
+		freeList.assign(free_blocks.begin(), free_blocks.end());
+		gen_blocks.swap(generations);
+
+		erases = counters[0];
+		erases_steady = counters[1];
+		logicalPageWrites = counters[2];
+		logicalPageWritesSteady = counters[3];
+		physicalPageWrites = counters[4];
+		physicalPageWritesSteady = counters[5];
+		Y = y;
+		dropOracle();
+		return true;
+	}
+
+private:
+
+	/* a list of blocks is saved as its size followed by the block numbers in order */
+
+	void writeBlockList(FILE* file, const vector<Block*>& list) const {
+		int size = list.size();
+		fwrite(&size, sizeof(size), 1, file);
+		for (Block* block : list) {
+			fwrite(&block->blockNo, sizeof(block->blockNo), 1, file);
+		}
+	}
+
+	bool readBlockList(FILE* file, vector<Block*>* list) {
+		int size;
+		if (fread(&size, sizeof(size), 1, file) != 1 || size < 0 || size > geometry.physical_blocks) {
+			return false;
+		}
+		for (int i = 0; i < size; i++) {
+			int block_num;
+			if (fread(&block_num, sizeof(block_num), 1, file) != 1 || block_num < 0
+					|| block_num >= geometry.physical_blocks) {
+				return false;
+			}
+			list->push_back(&blocks[block_num]);
+		}
+		return true;
 	}
 
 
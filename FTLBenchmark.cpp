@@ -0,0 +1,296 @@
+/*
+ *	Created by Eyal Lotan and Dor Sura.
+ */
+
+/*
+ *	Microbenchmarks of the FTL hot paths. Every benchmark runs on several geometries and is repeated a number of
+ *	times (samples); a sample times a batch of operations and gives one ns/op value. The median and the 5th/95th
+ *	percentiles of the samples are reported, so a change to FTL.hpp can be compared before and after without
+ *	being fooled by a single noisy run.
+ *	The FTL benchmarks start from a steady state FTL (warmed up with greedy writes until SteadyStateDetector
+ *	declares steady state), and the operations that change the FTL state run on a fresh copy of it every sample.
+ *
+ *	Benchmarks:
+ *	write_greedy            FTL::write with the greedy algorithm, GC included (ns per host write).
+ *	gc                      FTL::GC, i.e picking the victim block and blockClean (ns per GC).
+ *	update_obsolete         FTL::updateMappingTable of a mapped page: obsoleting it and updateObsolete (ns per page).
+ *	block_score             FTL::getBlockScore of every full block (ns per block).
+ *	block_scores            FTL::getBlockScores of all the full blocks at once, the batch kernel (ns per block).
+ *	best_block_to_evict     FTL::getBestBlockToEvict over the Y bucket (ns per call).
+ *	best_block_to_evict_wide, best_block_to_evict_parallel
+ *	                        the same over the Y..Y+4 buckets, on the calling thread and on a pool of all the cores.
+ *	location_index          AlgoRunner::buildLocationIndex over a window of T*Z writes (ns per window position).
+ *	kiss_uniform, kiss_hot_cold, philox_uniform, philox_hot_cold
+ *	                        the writing sequence sources, one chunk of the stream at a time (ns per position).
+ *
+ *	USAGE: ./FTLBenchmark [number of samples] [benchmark name]
+ */
+
+#include <algorithm>
+#include <iostream>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+#include "AlgoRunner.h"
+#include "Statistics.h"
+
+using namespace std;
+
+/* AlgoRunner.h refers to the help printer of the simulator */
+void printHelp() {}
+
+typedef std::chrono::steady_clock Clock;
+
+static double nanoseconds(Clock::time_point start, Clock::time_point end){
+    return std::chrono::duration<double, std::nano>(end - start).count();
+}
+
+/* a steady state FTL of a geometry, shared by the FTL benchmarks of that geometry */
+class SteadyFTL{
+public:
+    Geometry geometry;
+    FTL* ftl;
+    char* data;
+    std::mt19937 generator;
+
+    explicit SteadyFTL(const Geometry& geometry) : geometry(geometry), ftl(new FTL(geometry)),
+                                                   data(new char[geometry.page_size]), generator(12345) {
+        memset(data, 0, geometry.page_size);
+        SteadyStateDetector detector(ftl);
+        while (!detector.converged()) {
+            ftl->write(data, generator() % geometry.logicalPages(), GREEDY);
+            detector.recordWrite();
+        }
+    }
+
+    ~SteadyFTL() {
+        delete ftl;
+        delete [] data;
+    }
+
+    vector<unsigned int> randomPages(unsigned long long count){
+        vector<unsigned int> pages(count);
+        for (auto& page : pages) {
+            page = generator() % geometry.logicalPages();
+        }
+        return pages;
+    }
+};
+
+/* ns/op of the write path: one sample is a batch of max(T*Z, 65536) greedy writes on the (shared, steady) FTL */
+static double benchmarkWriteGreedy(SteadyFTL* steady){
+    vector<unsigned int> pages = steady->randomPages(std::max(steady->geometry.physicalPages(), 65536u));
+    auto start = Clock::now();
+    for (unsigned int page : pages) {
+        steady->ftl->write(steady->data, page, GREEDY);
+    }
+    return nanoseconds(start, Clock::now()) / pages.size();
+}
+
+/* ns/op of GC: the writes run untimed, and every GC the writes need (free list empty) is timed on its own */
+static double benchmarkGC(SteadyFTL* steady){
+    FTL* ftl = steady->ftl->clone();
+    vector<unsigned int> pages = steady->randomPages(std::max(steady->geometry.physicalPages(), 65536u));
+    double total = 0;
+    unsigned long long collections = 0;
+    for (unsigned int page : pages) {
+        if (ftl->freeList.empty()){
+            auto start = Clock::now();
+            ftl->GC();
+            total += nanoseconds(start, Clock::now());
+            collections++;
+        }
+        ftl->write(steady->data, page, GREEDY);
+    }
+    delete ftl;
+    return total / std::max(collections, 1ULL);
+}
+
+/* ns/op of obsoleting a page: a sample obsoletes a quarter of the mapped pages (distinct, random order) */
+static double benchmarkUpdateObsolete(SteadyFTL* steady){
+    FTL* ftl = steady->ftl->clone();
+    vector<unsigned int> pages(steady->geometry.logicalPages());
+    std::iota(pages.begin(), pages.end(), 0);
+    std::shuffle(pages.begin(), pages.end(), steady->generator);
+    pages.resize(pages.size() / 4);
+    Block* current = ftl->freeList.front();
+    unsigned long long count = 0;
+    auto start = Clock::now();
+    for (unsigned int page : pages) {
+        if (ftl->mappingTable[page] != UNMAPPED_PAGE){
+            ftl->updateMappingTable(page, current);
+            count++;
+        }
+    }
+    double total = nanoseconds(start, Clock::now());
+    delete ftl;
+    return total / std::max(count, 1ULL);
+}
+
+/* the lookahead benchmarks need a writing sequence and its next write index */
+class LookaheadFixture{
+public:
+    vector<unsigned int> sequence;
+    WorkloadStream* stream;
+    LookaheadIndex* index;
+
+    explicit LookaheadFixture(SteadyFTL* steady){
+        unsigned long long horizon = steady->geometry.physicalPages();
+        sequence = steady->randomPages(2 * horizon);
+        stream = new WorkloadStream(sequence.data(), sequence.size());
+        index = new LookaheadIndex(stream, sequence.size(), steady->geometry.logicalPages(), horizon);
+        index->extendWindow(0);
+    }
+
+    ~LookaheadFixture() {
+        delete index;
+        delete stream;
+    }
+};
+
+static double benchmarkBlockScore(SteadyFTL* steady, LookaheadFixture* fixture){
+    FTL* ftl = steady->ftl->clone();
+    ftl->setLookaheadIndex(fixture->index);
+    double checksum = 0;
+    unsigned long long count = 0;
+    auto start = Clock::now();
+    for (int k = 0; k <= steady->geometry.pages_per_block; k++) {
+        for (int block_num : ftl->V.bucket(k)) {
+            checksum += ftl->getBlockScore(block_num, 0);
+            count++;
+        }
+    }
+    double total = nanoseconds(start, Clock::now());
+    delete ftl;
+    /* keeps the scores from being optimized away */
+    if (checksum < 0){
+        cout << checksum;
+    }
+    return total / std::max(count, 1ULL);
+}
+
+static double benchmarkBlockScores(SteadyFTL* steady, LookaheadFixture* fixture){
+    FTL* ftl = steady->ftl->clone();
+    ftl->setLookaheadIndex(fixture->index);
+    vector<int> block_nums;
+    for (int k = 0; k <= steady->geometry.pages_per_block; k++) {
+        for (int block_num : ftl->V.bucket(k)) {
+            block_nums.push_back(block_num);
+        }
+    }
+    vector<double> scores;
+    auto start = Clock::now();
+    ftl->getBlockScores(block_nums, 0, &scores);
+    double total = nanoseconds(start, Clock::now());
+    delete ftl;
+    /* keeps the scores from being optimized away */
+    if (std::accumulate(scores.begin(), scores.end(), 0.0) < 0){
+        cout << "negative score" << endl;
+    }
+    return total / std::max(block_nums.size(), (size_t)1);
+}
+
+static double benchmarkBestBlockToEvict(SteadyFTL* steady, LookaheadFixture* fixture, int candidate_depth,
+                                       ThreadPool* score_pool){
+    FTL* ftl = steady->ftl->clone();
+    ftl->setLookaheadIndex(fixture->index);
+    ftl->candidate_depth = candidate_depth;
+    ftl->setScorePool(score_pool);
+    ftl->updateMinValid();
+    const int calls = 64;
+    Block* best = nullptr;
+    auto start = Clock::now();
+    for (int i = 0; i < calls; i++) {
+        best = ftl->getBestBlockToEvict(0);
+    }
+    double total = nanoseconds(start, Clock::now());
+    if (!best){
+        cout << "no block to evict" << endl;
+    }
+    delete ftl;
+    return total / calls;
+}
+
+static double benchmarkLocationIndex(AlgoRunner* runner){
+    unsigned int window_size = runner->geometry.physicalPages();
+    auto start = Clock::now();
+    runner->buildLocationIndex(0, window_size);
+    return nanoseconds(start, Clock::now()) / window_size;
+}
+
+/* ns/op of a sequence source: one sample generates one chunk of the stream */
+static double benchmarkSource(WritingSequenceSource* source){
+    vector<unsigned int> buffer(WORKLOAD_CHUNK_SIZE);
+    auto start = Clock::now();
+    source->generate(buffer.data(), buffer.size());
+    return nanoseconds(start, Clock::now()) / buffer.size();
+}
+
+static void printSummary(const string& name, const Geometry& geometry, const SampleSummary& summary){
+    cout << name << "\t" << geometry.physical_blocks << "\t" << geometry.logical_blocks << "\t"
+         << geometry.pages_per_block << "\t" << summary.percentile(50) << "\t" << summary.percentile(5) << "\t"
+         << summary.percentile(95) << endl;
+}
+
+int main(int argc, char** argv) {
+    int samples = argc > 1 ? atoi(argv[1]) : 21;
+    string only = argc > 2 ? argv[2] : "";
+
+    /* (T, U, Z) */
+    int geometries[][3] = {{64, 50, 32}, {256, 200, 64}, {1024, 900, 128}, {4096, 3600, 256}};
+
+    ThreadPool score_pool(ThreadPool::defaultSize());
+
+    cout << "Benchmark\tT\tU\tZ\tns/op (median)\tns/op (p5)\tns/op (p95)" << endl;
+    for (auto& dimensions : geometries) {
+        Geometry geometry(dimensions[0], dimensions[1], dimensions[2], 4096, 1ULL << 40);
+        SteadyFTL steady(geometry);
+        LookaheadFixture fixture(&steady);
+
+        UserParameters user_parameters = UserParameters();
+        user_parameters.hot_pages_percentage = 10;
+        user_parameters.hot_pages_probability = 0.9;
+        geometry.number_of_pages = 4 * geometry.physicalPages();
+        AlgoRunner runner(geometry, UNIFORM, WRITING_ASSIGNMENT, user_parameters, 12345, false);
+
+        KissGenerator kiss_generator(12345);
+        UniformSequenceSource kiss_uniform(geometry.logicalPages(), kiss_generator.fork());
+        HotColdSequenceSource kiss_hot_cold(geometry.logicalPages(), 10, 0.9, kiss_generator.fork());
+        PhiloxUniformSequenceSource philox_uniform(geometry.logicalPages(), 12345, 1);
+        PhiloxHotColdSequenceSource philox_hot_cold(geometry.logicalPages(), 10, 0.9, 12345, 1);
+
+        vector<pair<string, std::function<double()>>> benchmarks = {
+                {"write_greedy", [&] { return benchmarkWriteGreedy(&steady); }},
+                {"gc", [&] { return benchmarkGC(&steady); }},
+                {"update_obsolete", [&] { return benchmarkUpdateObsolete(&steady); }},
+                {"block_score", [&] { return benchmarkBlockScore(&steady, &fixture); }},
+                {"block_scores", [&] { return benchmarkBlockScores(&steady, &fixture); }},
+                {"best_block_to_evict", [&] { return benchmarkBestBlockToEvict(&steady, &fixture, 0, nullptr); }},
+                {"best_block_to_evict_wide", [&] { return benchmarkBestBlockToEvict(&steady, &fixture, 4, nullptr); }},
+                {"best_block_to_evict_parallel", [&] { return benchmarkBestBlockToEvict(&steady, &fixture, 4, &score_pool); }},
+                {"location_index", [&] { return benchmarkLocationIndex(&runner); }},
+                {"kiss_uniform", [&] { return benchmarkSource(&kiss_uniform); }},
+                {"kiss_hot_cold", [&] { return benchmarkSource(&kiss_hot_cold); }},
+                {"philox_uniform", [&] { return benchmarkSource(&philox_uniform); }},
+                {"philox_hot_cold", [&] { return benchmarkSource(&philox_hot_cold); }},
+        };
+        for (auto& benchmark : benchmarks) {
+            if (!only.empty() && benchmark.first != only){
+                continue;
+            }
+            /* one untimed run warms the caches and the allocator */
+            benchmark.second();
+            SampleSummary summary;
+            for (int i = 0; i < samples; i++) {
+                summary.add(benchmark.second());
+            }
+            printSummary(benchmark.first, geometry, summary);
+        }
+    }
+    return 0;
+}
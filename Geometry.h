@@ -0,0 +1,63 @@
+/*
+ *	Created by Eyal Lotan and Dor Sura.
+ */
+
+/*
+ *	Geometry describes the simulated flash device and workload length: T physical blocks, U logical blocks, Z pages
+ *	per block, the page size and N, the number of pages in the writing sequence.
+ *	Every FTL/AlgoRunner instance holds its own copy, so devices of different sizes can be simulated side by side
+ *	in one process.
+ */
+
+#ifndef FLASHGC_GEOMETRY_H
+#define FLASHGC_GEOMETRY_H
+
+class Geometry{
+public:
+    /* T - number of physical blocks */
+    int physical_blocks;
+
+    /* U - number of logical blocks */
+    int logical_blocks;
+
+    /* Z - number of pages per block */
+    int pages_per_block;
+
+    /* number of bytes per page */
+    int page_size;
+
+    /* N - number of pages in the writing sequence */
+    unsigned long long number_of_pages;
+
+    Geometry(int physical_blocks, int logical_blocks, int pages_per_block, int page_size,
+             unsigned long long number_of_pages) :
+             physical_blocks(physical_blocks), logical_blocks(logical_blocks), pages_per_block(pages_per_block),
+             page_size(page_size), number_of_pages(number_of_pages) {}
+
+    /* U*Z */
+    unsigned int logicalPages() const{
+        return logical_blocks * pages_per_block;
+    }
+
+    /* T*Z */
+    unsigned int physicalPages() const{
+        return physical_blocks * pages_per_block;
+    }
+
+    /* number of 64 bit words in the valid bitmap of a block */
+    int bitmapWords() const{
+        return (pages_per_block + 63) / 64;
+    }
+
+    /* alpha = U/T */
+    float alpha() const{
+        return (float)logical_blocks / physical_blocks;
+    }
+
+    /* OP = (T-U)/U */
+    float overProvisioning() const{
+        return (float)(physical_blocks - logical_blocks) / logical_blocks;
+    }
+};
+
+#endif //FLASHGC_GEOMETRY_H
@@ -0,0 +1,64 @@
+/*
+ *	Created by Eyal Lotan and Dor Sura.
+ */
+
+/*
+ *	Checks that simulations of different geometries are independent: two geometries (64/50/32 and 128/100/64)
+ *	with fixed seeds run side by side on two threads, then one after the other, and the erases, logical writes,
+ *	physical writes and WA of both runs must be exactly the same.
+ *
+ *	USAGE: ./GeometryConcurrencyTest (exits with 0 if the results match)
+ */
+
+#include <iostream>
+#include <thread>
+#include "SweepRunner.h"
+
+using namespace std;
+
+/* AlgoRunner.h refers to the help printer of the simulator */
+void printHelp() {}
+
+/* greedy_lookahead on a 10%/90% hot/cold workload of 100000 writes, no window */
+static SimulationConfig makeTestConfig(int physical_blocks, int logical_blocks, int pages_per_block,
+                                       unsigned long long seed){
+    SimulationConfig config;
+    config.geometry = Geometry(physical_blocks, logical_blocks, pages_per_block, 4096, 100000);
+    config.algo = GREEDY_LOOKAHEAD;
+    config.page_dist = HOT_COLD;
+    config.user_parameters.hot_pages_percentage = 10;
+    config.user_parameters.hot_pages_probability = 0.9;
+    config.user_parameters.window_size = config.geometry.number_of_pages;
+    config.seed = seed;
+    return config;
+}
+
+static bool sameResult(const SimulationResult& concurrent, const SimulationResult& sequential){
+    return concurrent.erases == sequential.erases && concurrent.logical_page_writes == sequential.logical_page_writes &&
+           concurrent.physical_page_writes == sequential.physical_page_writes &&
+           concurrent.write_amplification == sequential.write_amplification;
+}
+
+int main() {
+    SimulationConfig configs[] = {makeTestConfig(64, 50, 32, 7), makeTestConfig(128, 100, 64, 11)};
+
+    SimulationResult concurrent[2];
+    std::thread first([&] { concurrent[0] = SweepRunner::runSimulation(configs[0]); });
+    std::thread second([&] { concurrent[1] = SweepRunner::runSimulation(configs[1]); });
+    first.join();
+    second.join();
+
+    int failures = 0;
+    for (int i = 0; i < 2; i++) {
+        SimulationResult sequential = SweepRunner::runSimulation(configs[i]);
+        const Geometry& geometry = configs[i].geometry;
+        cout << geometry.physical_blocks << "/" << geometry.logical_blocks << "/" << geometry.pages_per_block
+             << ": concurrent " << concurrent[i].erases << " erases, WA " << concurrent[i].write_amplification
+             << "; sequential " << sequential.erases << " erases, WA " << sequential.write_amplification << endl;
+        if (!sameResult(concurrent[i], sequential)){
+            cerr << "Error! the concurrent and the sequential results differ." << endl;
+            failures++;
+        }
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,137 @@
+/*
+ *	Created by Eyal Lotan and Dor Sura.
+ */
+
+/*
+ *	LocationIndex lists, for every logical page written in a window of the writing sequence, all the locations
+ *	(indexes) in the window where it is written. It is a compressed sparse row (CSR) index: the pages of the window
+ *	get consecutive slots in the order they first appear, and the locations of slot s are
+ *	positions[offsets[s]..offsets[s+1]), in ascending order. It is built in two linear passes over the window (count
+ *	the writes of every page, then place every location at its page's next free position), with no per page
+ *	allocation, and the arrays are reused from window to window.
+ *	The writing assignment consumes the locations of a page from the front: cursor[s] is the first location of slot s
+ *	that was not consumed yet.
+ *
+ *	USAGE:
+ *	LocationIndex index(number_of_logical_pages);
+ *	index.build(writing_sequence, base_index, window_size, number_of_pages);
+ *	for (unsigned int slot = 0; slot < index.size(); slot++): index.pages[slot]; index.first(slot); index.second(slot);
+ *	index.pop(slot);
+ */
+
+#ifndef FLASHGC_LOCATIONINDEX_H
+#define FLASHGC_LOCATIONINDEX_H
+
+#include <algorithm>
+#include <cassert>
+#include <vector>
+#include "WorkloadStream.h"
+
+/* returned by LocationIndex::second when the page is not written again in the window */
+#define NOT_EXIST -3
+
+/* slot_of value of a page that is not written in the window */
+#define NO_SLOT -1
+
+class LocationIndex{
+public:
+    /* first location of the window */
+    unsigned long long base_index;
+
+    /* the logical page of every slot */
+    std::vector<unsigned int> pages;
+
+    /* locations of slot s are positions[offsets[s]..offsets[s+1]) */
+    std::vector<unsigned int> offsets;
+    std::vector<unsigned long long> positions;
+
+    /* number of consumed locations of every slot */
+    std::vector<unsigned int> cursor;
+
+    /* slot of the page written at every location of the window (relative to base_index) */
+    std::vector<int> slot_at;
+
+    /* slot of every logical page, NO_SLOT for the pages that are not in the window. only the entries of the pages
+     * of the current window are set, so starting a new window costs O(window) and not O(logical pages)
+     */
+    std::vector<int> slot_of;
+
+    explicit LocationIndex(unsigned int number_of_logical_pages) : base_index(0),
+                                                                   slot_of(number_of_logical_pages, NO_SLOT) {}
+
+    /* index the locations [base_index, base_index + window_size) of the sequence (up to number_of_pages) */
+    void build(WorkloadStream* writing_sequence, unsigned long long base_index, unsigned int window_size,
+               unsigned long long number_of_pages){
+        for (unsigned int page : pages) {
+            slot_of[page] = NO_SLOT;
+        }
+        pages.clear();
+        offsets.clear();
+        this->base_index = base_index;
+        unsigned long long end = std::min(base_index + window_size, number_of_pages);
+        unsigned int length = end > base_index ? end - base_index : 0;
+        slot_at.resize(length);
+
+        /* first pass: slots in order of first appearance, and the number of writes of every slot */
+        for (unsigned int i = 0; i < length; i++) {
+            unsigned int page = writing_sequence->at(base_index + i);
+            if (slot_of[page] == NO_SLOT){
+                slot_of[page] = pages.size();
+                pages.push_back(page);
+                offsets.push_back(0);
+            }
+            slot_at[i] = slot_of[page];
+            offsets[slot_at[i]]++;
+        }
+
+        /* exclusive prefix sums: the counts become the first position of every slot */
+        unsigned int total = 0;
+        for (unsigned int& offset : offsets) {
+            unsigned int count = offset;
+            offset = total;
+            total += count;
+        }
+        offsets.push_back(total);
+
+        /* second pass: the locations in ascending order, using cursor as the fill position of every slot */
+        positions.resize(length);
+        cursor.assign(pages.size(), 0);
+        for (unsigned int i = 0; i < length; i++) {
+            int slot = slot_at[i];
+            positions[offsets[slot] + cursor[slot]++] = base_index + i;
+        }
+        std::fill(cursor.begin(), cursor.end(), 0);
+    }
+
+    /* number of distinct pages in the window */
+    unsigned int size() const{
+        return pages.size();
+    }
+
+    /* number of locations of the slot that were not consumed yet */
+    unsigned int remaining(int slot) const{
+        return offsets[slot + 1] - offsets[slot] - cursor[slot];
+    }
+
+    /* first location of the slot that was not consumed yet */
+    unsigned long long first(int slot) const{
+        assert(remaining(slot) > 0);
+        return positions[offsets[slot] + cursor[slot]];
+    }
+
+    /* the location after first(), i.e the next overwrite of the page, or NOT_EXIST */
+    long long second(int slot) const{
+        if (remaining(slot) <= 1){
+            return NOT_EXIST;
+        }
+        return positions[offsets[slot] + cursor[slot] + 1];
+    }
+
+    /* consume first() */
+    void pop(int slot){
+        assert(remaining(slot) > 0);
+        cursor[slot]++;
+    }
+};
+
+#endif //FLASHGC_LOCATIONINDEX_H
@@ -0,0 +1,112 @@
+/*
+ *	Created by Eyal Lotan and Dor Sura.
+ */
+
+/*
+ *	LookaheadIndex is a "next write" index over a sliding window of the writing sequence. For every position i in
+ *	the window it holds the next position where the same logical page is written again, and for every logical page
+ *	it holds a cursor to the next position (at or after the current write) where that page is written.
+ *	This lets the lookahead algorithms find when a page dies in O(1) instead of rescanning the sequence.
+ *	The index only looks 'horizon' positions ahead of the current write: a page that is not written again within
+ *	the horizon is reported as never written again (number_of_pages).
+ */
+
+#ifndef FLASHGC_LOOKAHEADINDEX_H
+#define FLASHGC_LOOKAHEADINDEX_H
+
+#include <cassert>
+#include "WorkloadStream.h"
+#include "Profiler.h"
+
+class LookaheadIndex{
+public:
+    /* the writing sequence the index is built over */
+    WorkloadStream* writing_sequence;
+
+    /* length of the writing sequence. also used as the "not written again within the horizon" marker */
+    unsigned long long number_of_pages;
+
+    /* number of logical pages (U*Z) */
+    unsigned int number_of_logical_pages;
+
+    /* how many positions ahead of the current write the index looks */
+    unsigned long long horizon;
+
+    /* positions [0, frontier) were added to the index */
+    unsigned long long frontier;
+
+    /* ring of horizon+1 entries: next_occurrence[i % (horizon+1)] is the smallest j > i, j < frontier such that
+     * writing_sequence[j] == writing_sequence[i], or number_of_pages if there is no such j (yet).
+     */
+    unsigned long long* next_occurrence;
+
+    /* next_write[lpn] is the smallest index >= current position, index < frontier such that
+     * writing_sequence[index] == lpn, or number_of_pages if there is no such index.
+     */
+    unsigned long long* next_write;
+
+    /* last_position[lpn] is the last position added to the index where lpn is written. only meaningful while
+     * next_write[lpn] != number_of_pages.
+     */
+    unsigned long long* last_position;
+
+    LookaheadIndex(WorkloadStream* writing_sequence, unsigned long long number_of_pages,
+                   unsigned int number_of_logical_pages, unsigned long long horizon) :
+                   writing_sequence(writing_sequence), number_of_pages(number_of_pages),
+                   number_of_logical_pages(number_of_logical_pages), horizon(horizon), frontier(0),
+                   next_occurrence(new unsigned long long[horizon + 1]),
+                   next_write(new unsigned long long[number_of_logical_pages]),
+                   last_position(new unsigned long long[number_of_logical_pages]) {
+        for (unsigned int lpn = 0; lpn < number_of_logical_pages; ++lpn) {
+            next_write[lpn] = number_of_pages;
+            last_position[lpn] = number_of_pages;
+        }
+    }
+
+    ~LookaheadIndex() {
+        delete [] next_occurrence;
+        delete [] next_write;
+        delete [] last_position;
+    }
+
+    /* add positions to the index so that it covers [page_index, page_index + horizon) */
+    void extendWindow(unsigned long long page_index){
+        PROFILE_SCOPE(PROFILE_LOOKAHEAD_INDEX);
+        unsigned long long end = std::min(page_index + horizon, number_of_pages);
+        while (frontier < end) {
+            unsigned int lpn = writing_sequence->at(frontier);
+            next_occurrence[frontier % (horizon + 1)] = number_of_pages;
+            if (next_write[lpn] == number_of_pages){
+                next_write[lpn] = frontier;
+            }
+            else {
+                next_occurrence[last_position[lpn] % (horizon + 1)] = frontier;
+            }
+            last_position[lpn] = frontier;
+            frontier++;
+        }
+    }
+
+    /* get the next position (at or after the current write) where lpn is written */
+    unsigned long long nextWrite(unsigned int lpn) const{
+        return next_write[lpn];
+    }
+
+    /* get the next position after page_index where the page written in page_index is written again */
+    unsigned long long nextOccurrence(unsigned long long page_index) const{
+        assert(page_index < frontier && page_index + horizon + 1 > frontier);
+        return next_occurrence[page_index % (horizon + 1)];
+    }
+
+    /* move the cursor of the page written at page_index past that write. must be called for every
+     * position of the writing sequence, in order, once the write has been done.
+     */
+    void advance(unsigned long long page_index){
+        assert(page_index < frontier);
+        unsigned int lpn = writing_sequence->at(page_index);
+        assert(next_write[lpn] == page_index);
+        next_write[lpn] = next_occurrence[page_index % (horizon + 1)];
+    }
+};
+
+#endif //FLASHGC_LOOKAHEADINDEX_H
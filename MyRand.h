@@ -10,12 +10,20 @@
  * The need for the custom generator emerged from the fact that the STL rand()
  * returns only 32768 different numbers (between 0 and 32767), less than the
  * range needed for this simulation. Marsaglia's algorithm is fast and performs
- * very well on randomness tests. The STL rand() is used for seeding.
+ * very well on randomness tests. std::mt19937_64 is used for seeding.
  */
 
 /* USAGE:
- * seed() - once before using KISS().
- * KISS().
+ * KissGenerator generator(seed);
+ * generator() - the next random number.
+ * generator.fork() - a new generator for another consumer (e.g a writing sequence source).
+ * Every simulation owns its generators, so runs with the same seed are reproducible and runs on different threads
+ * never share state.
+ *
+ * Philox4x32 is a counter based generator: its output is a function of (seed, index) only, so any part of a
+ * sequence can be generated on its own, in any order and on any thread, and the result is identical to
+ * generating it serially. The Philox sequence sources split every chunk of the writing sequence over a thread
+ * pool.
  */
 
 #ifndef MYRAND_H_
@@ -26,116 +34,336 @@
 #include <cstdlib>
 #include <cmath>
 #include <random>
+#include <cstdint>
 #include "main.hpp"
 #include "Auxilaries.h"
+#include "ThreadPool.h"
 
 
 using namespace std;
 
-static unsigned int x = 123456789, y = 362436000, z = 521288629, c = 7654321; /* Seed variables */
+/* a single KISS generator state */
+class KissGenerator {
+public:
+	unsigned int x, y, z, c; /* Seed variables */
 
-unsigned int KISS() {
-	unsigned long long t, a = 698769069ULL;
+	KissGenerator() : x(123456789), y(362436000), z(521288629), c(7654321) {}
 
-	x = 69069 * x + 12345;
-	y ^= (y << 13);
-	y ^= (y >> 17);
-	y ^= (y << 5); /* y must never be set to zero! */
-	t = a * z + c;
-	c = (t >> 32); /* Also avoid setting z=c=0! */
+	KissGenerator(unsigned int x, unsigned int y, unsigned int z, unsigned int c) : x(x), y(y), z(z), c(c) {}
 
-	return x + y + (z = t);
-}
-void seed() {
-	srand(time(nullptr));
-	do {
-		x = time(nullptr);
-		y = pow(rand() % 1621, 3);
-		z = pow(rand() % 251, 4);
-		c = 104729 * rand();
-	} while (y == 0 || z == 0 || c == 0);
-}
+	/* seed from an explicit value */
+	explicit KissGenerator(unsigned long long seed) {
+		std::mt19937_64 seeder(seed);
+		do {
+			x = seeder();
+			y = seeder();
+			z = seeder();
+			c = seeder();
+		} while (y == 0 || z == 0 || c == 0);
+	}
 
-static std::uniform_int_distribution<int> num_generator_hot;
-std::default_random_engine gen_hot;
-static std::uniform_int_distribution<int> num_generator_cold;
-std::default_random_engine gen_cold;
-static std::uniform_int_distribution<int> num_generator_toss;
-std::default_random_engine gen_toss;
-
-
-void setUniformDistributionGenerator(int range_from, int range_to, RandVariable indicator){
-    std::default_random_engine generator(time(nullptr));
-    std::uniform_int_distribution<int>  distr(range_from, range_to);
-
-    switch (indicator) {
-        case HOT:
-            num_generator_hot = distr;
-            gen_hot = generator;
-        case COLD:
-            num_generator_cold = distr;
-            gen_cold = generator;
-        case COIN_TOSS:
-            num_generator_toss = distr;
-            gen_toss = generator;
-    }
+	unsigned int operator()() {
+		unsigned long long t, a = 698769069ULL;
 
-}
+		x = 69069 * x + 12345;
+		y ^= (y << 13);
+		y ^= (y >> 17);
+		y ^= (y << 5); /* y must never be set to zero! */
+		t = a * z + c;
+		c = (t >> 32); /* Also avoid setting z=c=0! */
+
+		return x + y + (z = t);
+	}
+
+	/* get a new generator seeded from this generator's stream */
+	KissGenerator fork() {
+		KissGenerator generator;
+		do {
+			unsigned int fork_x = (*this)();
+			unsigned int fork_y = (*this)();
+			unsigned int fork_z = (*this)();
+			unsigned int fork_c = (*this)();
+			generator = KissGenerator(fork_x, fork_y, fork_z, fork_c);
+		} while (generator.y == 0 || generator.z == 0 || generator.c == 0);
+		return generator;
+	}
+};
+
+/* number of Philox blocks computed side by side by Philox4x32::blocks() */
+#define PHILOX_BATCH 8
+
+/* Philox4x32-10 (Salmon et al., "Parallel random numbers: as easy as 1, 2, 3", SC'11): 10 rounds of a multiply
+ * and xor bijection over a 128 bit counter, keyed by the seed.
+ */
+class Philox4x32 {
+public:
+	uint32_t key[2];
+
+	explicit Philox4x32(unsigned long long seed) {
+		key[0] = (uint32_t)seed;
+		key[1] = (uint32_t)(seed >> 32);
+	}
+
+	/* the 4 random words of block 'counter' */
+	void block(unsigned long long counter, uint32_t out[4]) const {
+		uint32_t c0 = (uint32_t)counter, c1 = (uint32_t)(counter >> 32), c2 = 0, c3 = 0;
+		uint32_t k0 = key[0], k1 = key[1];
+		for (int round = 0; round < 10; round++) {
+			uint64_t product0 = (uint64_t)0xD2511F53 * c0;
+			uint64_t product1 = (uint64_t)0xCD9E8D57 * c2;
+			c0 = (uint32_t)(product1 >> 32) ^ c1 ^ k0;
+			c1 = (uint32_t)product1;
+			c2 = (uint32_t)(product0 >> 32) ^ c3 ^ k1;
+			c3 = (uint32_t)product0;
+			k0 += 0x9E3779B9;
+			k1 += 0xBB67AE85;
+		}
+		out[0] = c0;
+		out[1] = c1;
+		out[2] = c2;
+		out[3] = c3;
+	}
 
-/* function for generation a number from one of the uniform engines */
-
-int getNumber(RandVariable indicator){
-    switch (indicator) {
-        case HOT:
-            return num_generator_hot(gen_hot);
-        case COLD:
-            return num_generator_cold(gen_cold);
-        case COIN_TOSS:
-            return num_generator_toss(gen_toss);
-    }
-    return -1; // error //
+	/* the words of the PHILOX_BATCH blocks starting at first_counter: out[word][i] is word 'word' of block
+	 * first_counter + i. the rounds run over all the blocks at once, so the compiler vectorizes them.
+	 */
+	void blocks(unsigned long long first_counter, uint32_t out[4][PHILOX_BATCH]) const {
+		uint32_t c0[PHILOX_BATCH], c1[PHILOX_BATCH], c2[PHILOX_BATCH], c3[PHILOX_BATCH];
+		for (int i = 0; i < PHILOX_BATCH; i++) {
+			c0[i] = (uint32_t)(first_counter + i);
+			c1[i] = (uint32_t)((first_counter + i) >> 32);
+			c2[i] = 0;
+			c3[i] = 0;
+		}
+		uint32_t k0 = key[0], k1 = key[1];
+		for (int round = 0; round < 10; round++) {
+			for (int i = 0; i < PHILOX_BATCH; i++) {
+				uint64_t product0 = (uint64_t)0xD2511F53 * c0[i];
+				uint64_t product1 = (uint64_t)0xCD9E8D57 * c2[i];
+				c0[i] = (uint32_t)(product1 >> 32) ^ c1[i] ^ k0;
+				c1[i] = (uint32_t)product1;
+				c2[i] = (uint32_t)(product0 >> 32) ^ c3[i] ^ k1;
+				c3[i] = (uint32_t)product0;
+			}
+			k0 += 0x9E3779B9;
+			k1 += 0xBB67AE85;
+		}
+		for (int i = 0; i < PHILOX_BATCH; i++) {
+			out[0][i] = c0[i];
+			out[1][i] = c1[i];
+			out[2][i] = c2[i];
+			out[3][i] = c3[i];
+		}
+	}
+};
+
+/* map a random 32 bit word to [0, range) (multiply and shift, no division) */
+inline unsigned int scaleToRange(uint32_t word, unsigned int range) {
+	return (unsigned int)(((uint64_t)word * range) >> 32);
 }
 
-/* generate a uniformly distributed writing sequence of length NUMBER_OF_PAGES.
+/* a source of a writing sequence. generate() fills the next 'count' logical page numbers of the sequence,
+ * so the sequence can be produced chunk by chunk and never has to be fully materialized.
+ */
+class WritingSequenceSource {
+public:
+	virtual ~WritingSequenceSource() {}
+
+	virtual void generate(unsigned int* buffer, unsigned long long count) = 0;
+};
+
+/* uniformly distributed writing sequence.
  * the sequence is generated using the KISS generator, and using mod function to
- * get a logical page number between 0 and LOGICAL_PAGE_NUMBER*PAGES_PER_BLOCK - 1
+ * get a logical page number between 0 and U*Z - 1
  */
+class UniformSequenceSource : public WritingSequenceSource {
+public:
+	unsigned int number_of_logical_pages;
+	KissGenerator generator;
 
-unsigned int* generateUniformlyDistributedWriteSequence(){
-    unsigned int* writing_sequence = new unsigned int[NUMBER_OF_PAGES];
-    for (unsigned long long i = 0; i < NUMBER_OF_PAGES; ++i) {
-        writing_sequence[i] = KISS() % (LOGICAL_BLOCK_NUMBER*PAGES_PER_BLOCK);
-    }
-    return writing_sequence;
-}
+	UniformSequenceSource(unsigned int number_of_logical_pages, const KissGenerator& generator) :
+			number_of_logical_pages(number_of_logical_pages), generator(generator) {}
 
-/* generate a Hot & Cold pages writing sequence of length NUMBER_OF_PAGES.
+	void generate(unsigned int* buffer, unsigned long long count) override {
+		for (unsigned long long i = 0; i < count; ++i) {
+			buffer[i] = generator() % number_of_logical_pages;
+		}
+	}
+};
+
+/* Hot & Cold pages writing sequence.
  * the sequence is generated using a uniform distribution generator.
  * @param hot_page_percentage is the percentage of hot pages out of total number of logical pages.
  * @p_hot is the probability for a given write to be a hot page write.
  * Note: within each area (Hot/Cold areas) the pages are picked uniformly.
  */
+class HotColdSequenceSource : public WritingSequenceSource {
+public:
+	double p_hot;
 
-unsigned int* generateHotColdWriteSequence(double hot_page_percentage, double p_hot){
-    unsigned int* writing_sequence = new unsigned int[NUMBER_OF_PAGES];
-
-    /* set Hot and Cold distribution engines. The selection of pages within every memory area is uniform */
-    setUniformDistributionGenerator(0,(LOGICAL_BLOCK_NUMBER*PAGES_PER_BLOCK)*(double)(hot_page_percentage / 100) , HOT);
-    setUniformDistributionGenerator((LOGICAL_BLOCK_NUMBER*PAGES_PER_BLOCK)*(double)(hot_page_percentage / 100) + 1,(LOGICAL_BLOCK_NUMBER*PAGES_PER_BLOCK) - 1 ,COLD);
-
-    /* this is a simple uniform distribution variable to represent a coin toss with probability p */
-    setUniformDistributionGenerator(1,10,COIN_TOSS);
-
-    for (unsigned int i = 0; i < NUMBER_OF_PAGES; ++i) {
-        int coin_toss = getNumber(COIN_TOSS);
-        if (coin_toss <= p_hot*10){
-            writing_sequence[i] = getNumber(HOT);
-        }
-        else {
-            writing_sequence[i] = getNumber(COLD);
-        }
-    }
-    return writing_sequence;
-}
+	/* Hot and Cold distribution engines. The selection of pages within every memory area is uniform */
+	std::uniform_int_distribution<int> num_generator_hot;
+	std::default_random_engine gen_hot;
+	std::uniform_int_distribution<int> num_generator_cold;
+	std::default_random_engine gen_cold;
+
+	/* this is a simple uniform distribution variable to represent a coin toss with probability p */
+	std::uniform_int_distribution<int> num_generator_toss;
+	std::default_random_engine gen_toss;
+
+	HotColdSequenceSource(unsigned int number_of_logical_pages, double hot_page_percentage, double p_hot,
+						  KissGenerator generator) :
+			p_hot(p_hot),
+			num_generator_hot(0, number_of_logical_pages * (double)(hot_page_percentage / 100)),
+			gen_hot(generator()),
+			num_generator_cold(number_of_logical_pages * (double)(hot_page_percentage / 100) + 1,
+							   number_of_logical_pages - 1),
+			gen_cold(generator()),
+			num_generator_toss(1, 10),
+			gen_toss(generator()) {}
+
+	void generate(unsigned int* buffer, unsigned long long count) override {
+		for (unsigned long long i = 0; i < count; ++i) {
+			int coin_toss = num_generator_toss(gen_toss);
+			if (coin_toss <= p_hot*10){
+				buffer[i] = num_generator_hot(gen_hot);
+			}
+			else {
+				buffer[i] = num_generator_cold(gen_cold);
+			}
+		}
+	}
+};
+
+/* a writing sequence source over a Philox generator. position i of the sequence only depends on the seed and i,
+ * so generate() splits its range into parts, fills them in parallel on a thread pool and the sequence is
+ * bit identical for any number of threads.
+ */
+class PhiloxSequenceSource : public WritingSequenceSource {
+public:
+	Philox4x32 philox;
+
+	/* next position of the sequence to generate */
+	unsigned long long position;
+
+	/* nullptr for a single generation thread (the stream's own thread) */
+	ThreadPool* pool;
+
+	PhiloxSequenceSource(unsigned long long seed, int number_of_threads) :
+			philox(seed), position(0), pool(number_of_threads > 1 ? new ThreadPool(number_of_threads) : nullptr) {}
+
+	~PhiloxSequenceSource() override {
+		delete pool;
+	}
+
+	void generate(unsigned int* buffer, unsigned long long count) override {
+		unsigned long long first = position;
+		position += count;
+		if (!pool) {
+			fill(buffer, first, count);
+			return;
+		}
+		/* parts are multiples of 64 positions, so they start on batch bounds */
+		unsigned long long part = ((count + pool->size() - 1) / pool->size() + 63) / 64 * 64;
+		for (unsigned long long begin = 0; begin < count; begin += part) {
+			unsigned long long length = std::min(part, count - begin);
+			pool->submit([this, buffer, first, begin, length] {
+				fill(buffer + begin, first + begin, length);
+			});
+		}
+		pool->wait();
+	}
+
+	/* fill buffer with positions [first, first + count) of the sequence. must be thread safe */
+	virtual void fill(unsigned int* buffer, unsigned long long first, unsigned long long count) const = 0;
+};
+
+/* uniformly distributed writing sequence: every Philox block holds 4 consecutive positions */
+class PhiloxUniformSequenceSource : public PhiloxSequenceSource {
+public:
+	unsigned int number_of_logical_pages;
+
+	PhiloxUniformSequenceSource(unsigned int number_of_logical_pages, unsigned long long seed, int number_of_threads) :
+			PhiloxSequenceSource(seed, number_of_threads), number_of_logical_pages(number_of_logical_pages) {}
+
+	unsigned int pageAt(unsigned long long index) const {
+		uint32_t words[4];
+		philox.block(index / 4, words);
+		return scaleToRange(words[index % 4], number_of_logical_pages);
+	}
+
+	void fill(unsigned int* buffer, unsigned long long first, unsigned long long count) const override {
+		const unsigned long long batch_positions = 4 * PHILOX_BATCH;
+		unsigned long long end = first + count;
+		unsigned long long i = first;
+		for (; i < end && i % batch_positions != 0; i++) {
+			buffer[i - first] = pageAt(i);
+		}
+		uint32_t words[4][PHILOX_BATCH];
+		for (; i + batch_positions <= end; i += batch_positions) {
+			philox.blocks(i / 4, words);
+			for (int block = 0; block < PHILOX_BATCH; block++) {
+				for (int word = 0; word < 4; word++) {
+					buffer[i - first + block * 4 + word] = scaleToRange(words[word][block], number_of_logical_pages);
+				}
+			}
+		}
+		for (; i < end; i++) {
+			buffer[i - first] = pageAt(i);
+		}
+	}
+};
+
+/* Hot & Cold pages writing sequence over Philox, with the same hot/cold areas and coin toss as
+ * HotColdSequenceSource: every position takes 2 words, one for the coin toss and one for the page.
+ */
+class PhiloxHotColdSequenceSource : public PhiloxSequenceSource {
+public:
+	double p_hot;
+
+	/* the hot area is [0, last_hot_page], the cold area is [last_hot_page + 1, number_of_logical_pages - 1] */
+	unsigned int last_hot_page;
+	unsigned int number_of_logical_pages;
+
+	PhiloxHotColdSequenceSource(unsigned int number_of_logical_pages, double hot_page_percentage, double p_hot,
+								unsigned long long seed, int number_of_threads) :
+			PhiloxSequenceSource(seed, number_of_threads), p_hot(p_hot),
+			last_hot_page(number_of_logical_pages * (double)(hot_page_percentage / 100)),
+			number_of_logical_pages(number_of_logical_pages) {}
+
+	unsigned int page(uint32_t toss_word, uint32_t page_word) const {
+		int coin_toss = scaleToRange(toss_word, 10) + 1;
+		if (coin_toss <= p_hot*10){
+			return scaleToRange(page_word, last_hot_page + 1);
+		}
+		return last_hot_page + 1 + scaleToRange(page_word, number_of_logical_pages - last_hot_page - 1);
+	}
+
+	unsigned int pageAt(unsigned long long index) const {
+		uint32_t words[4];
+		philox.block(index / 2, words);
+		return page(words[(index % 2) * 2], words[(index % 2) * 2 + 1]);
+	}
+
+	void fill(unsigned int* buffer, unsigned long long first, unsigned long long count) const override {
+		const unsigned long long batch_positions = 2 * PHILOX_BATCH;
+		unsigned long long end = first + count;
+		unsigned long long i = first;
+		for (; i < end && i % batch_positions != 0; i++) {
+			buffer[i - first] = pageAt(i);
+		}
+		uint32_t words[4][PHILOX_BATCH];
+		for (; i + batch_positions <= end; i += batch_positions) {
+			philox.blocks(i / 2, words);
+			for (int block = 0; block < PHILOX_BATCH; block++) {
+				buffer[i - first + block * 2] = page(words[0][block], words[1][block]);
+				buffer[i - first + block * 2 + 1] = page(words[2][block], words[3][block]);
+			}
+		}
+		for (; i < end; i++) {
+			buffer[i - first] = pageAt(i);
+		}
+	}
+};
 
 #endif /* MYRAND_H_ */
@@ -0,0 +1,141 @@
+/*
+ *	Created by Eyal Lotan and Dor Sura.
+ */
+
+/*
+ *	OracleQueue is the state of the oracle victim selection (the ORACLE algorithm). For every block it keeps the
+ *	number of its valid pages that are written again within a horizon ("dying" pages, which become obsolete
+ *	on their own if the block is left alone), and it keeps the full blocks in an indexed binary min heap
+ *	by a key the FTL computes from the valid and dying pages of the block.
+ *	The FTL updates the counts and the keys on every write, obsoleted page and relocation, and when the next write
+ *	of a page enters the horizon, so picking the victim is reading the top of the heap and every update is
+ *	O(log T), whatever the length of the horizon is.
+ *	Blocks with equal keys are ordered by block number, so the choices are deterministic.
+ */
+
+#ifndef FLASHGC_ORACLEQUEUE_H
+#define FLASHGC_ORACLEQUEUE_H
+
+#include <cassert>
+#include "ValidBuckets.h"
+
+class OracleQueue{
+public:
+    /* number of blocks (T) */
+    int number_of_blocks;
+
+    /* a page is dying if it is written again within 'horizon' writes */
+    unsigned long long horizon;
+
+    /* number of dying pages of every block */
+    int* dying;
+
+    /* the full blocks, a binary min heap by (key, block number) in heap[0, size) */
+    int* heap;
+    int size;
+
+    /* index of every block in heap, NO_BLOCK if the block is not in the heap */
+    int* position;
+
+    /* key of every block in the heap */
+    long long* key;
+
+    OracleQueue(int number_of_blocks, unsigned long long horizon) :
+                number_of_blocks(number_of_blocks), horizon(horizon), dying(new int[number_of_blocks]()),
+                heap(new int[number_of_blocks]), size(0), position(new int[number_of_blocks]),
+                key(new long long[number_of_blocks]()) {
+        for (int i = 0; i < number_of_blocks; i++) {
+            position[i] = NO_BLOCK;
+        }
+    }
+
+    ~OracleQueue() {
+        delete [] dying;
+        delete [] heap;
+        delete [] position;
+        delete [] key;
+    }
+
+    void insert(int block, long long block_key){
+        assert(position[block] == NO_BLOCK);
+        key[block] = block_key;
+        heap[size] = block;
+        position[block] = size;
+        size++;
+        siftUp(position[block]);
+    }
+
+    void erase(int block){
+        int i = position[block];
+        assert(i != NO_BLOCK);
+        size--;
+        position[block] = NO_BLOCK;
+        if (i == size){
+            return;
+        }
+        /* the last block of the heap takes the place of the erased one */
+        int moved = heap[size];
+        place(i, moved);
+        siftUp(i);
+        siftDown(position[moved]);
+    }
+
+    /* change the key of a block in the heap */
+    void update(int block, long long block_key){
+        assert(position[block] != NO_BLOCK);
+        key[block] = block_key;
+        siftUp(position[block]);
+        siftDown(position[block]);
+    }
+
+    bool contains(int block) const{
+        return position[block] != NO_BLOCK;
+    }
+
+    bool empty() const{
+        return size == 0;
+    }
+
+    /* the block with the smallest key */
+    int top() const{
+        assert(size > 0);
+        return heap[0];
+    }
+
+private:
+    bool less(int a, int b) const{
+        return key[a] < key[b] || (key[a] == key[b] && a < b);
+    }
+
+    void place(int i, int block){
+        heap[i] = block;
+        position[block] = i;
+    }
+
+    void siftUp(int i){
+        int block = heap[i];
+        while (i > 0 && less(block, heap[(i - 1) / 2])) {
+            place(i, heap[(i - 1) / 2]);
+            i = (i - 1) / 2;
+        }
+        place(i, block);
+    }
+
+    void siftDown(int i){
+        int block = heap[i];
+        while (2 * i + 1 < size) {
+            int child = 2 * i + 1;
+            if (child + 1 < size && less(heap[child + 1], heap[child])){
+                child++;
+            }
+            if (!less(heap[child], block)){
+                break;
+            }
+            place(i, heap[child]);
+            i = child;
+        }
+        place(i, block);
+    }
+};
+
+#endif //FLASHGC_ORACLEQUEUE_H
@@ -0,0 +1,190 @@
+/*
+ *	Created by Eyal Lotan and Dor Sura.
+ */
+
+/*
+ *	Phase timers and event counters of the simulator, for finding out where the time of a slow run goes.
+ *	They are compiled in only when FLASHGC_PROFILE is defined (cmake -DFLASHGC_PROFILE=ON, or make PROFILE=1);
+ *	otherwise every PROFILE_ macro expands to nothing and the simulator is exactly the same as without them.
+ *
+ *	PROFILE_SCOPE(phase) times the rest of the enclosing scope and adds it to the phase. The timestamps are read with
+ *	rdtsc on x86 (a few ns per scope) and with steady_clock elsewhere, and converted to seconds when the profile is
+ *	printed. Phases nest: the victim selection and the block clean of a GC are also part of the gc phase, and the
+ *	sequence generation runs on the generator thread of the stream, so it overlaps with the rest.
+ *	PROFILE_COUNT(counter, n) adds n to an event counter.
+ *	Every thread collects into its own thread_local profile, which is added to the process profile when the thread
+ *	exits, so the worker threads of replicas, sweeps and lockstep runs need no locking. PROFILE_DUMP() prints the
+ *	process profile (plus the calling thread's), so it should be called once the worker threads are done.
+ *
+ *	USAGE:
+ *	void GC() {
+ *	    PROFILE_SCOPE(PROFILE_GC);
+ *	    ...
+ *	}
+ *	PROFILE_COUNT(PROFILE_RELOCATED_PAGES, counter);
+ */
+
+#ifndef FLASHGC_PROFILER_H
+#define FLASHGC_PROFILER_H
+
+#ifdef FLASHGC_PROFILE
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+enum ProfilePhase {PROFILE_GC, PROFILE_VICTIM_SELECTION, PROFILE_BLOCK_CLEAN, PROFILE_MAPPING_UPDATE,
+                   PROFILE_LOCATION_INDEX, PROFILE_LOOKAHEAD_INDEX, PROFILE_SEQUENCE_GENERATION, PROFILE_PHASES};
+
+enum ProfileCounter {PROFILE_BLOCK_CLEANS, PROFILE_RELOCATED_PAGES, PROFILE_BUCKET_MOVES, PROFILE_COUNTERS};
+
+inline const char* profilePhaseName(int phase){
+    static const char* names[] = {"gc", "victim_selection", "block_clean", "mapping_update", "location_index",
+                                  "lookahead_index", "sequence_generation"};
+    return names[phase];
+}
+
+inline const char* profileCounterName(int counter){
+    static const char* names[] = {"block_cleans", "relocated_pages", "bucket_moves"};
+    return names[counter];
+}
+
+inline uint64_t profileTicks(){
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+}
+
+class ProfileData{
+public:
+    uint64_t ticks[PROFILE_PHASES];
+    uint64_t calls[PROFILE_PHASES];
+    uint64_t counters[PROFILE_COUNTERS];
+
+    ProfileData() : ticks(), calls(), counters() {}
+
+    void add(const ProfileData& other){
+        for (int i = 0; i < PROFILE_PHASES; i++) {
+            ticks[i] += other.ticks[i];
+            calls[i] += other.calls[i];
+        }
+        for (int i = 0; i < PROFILE_COUNTERS; i++) {
+            counters[i] += other.counters[i];
+        }
+    }
+};
+
+class Profiler{
+public:
+    /* the profile of the calling thread */
+    static ProfileData& local(){
+        thread_local ThreadProfile thread_profile;
+        return thread_profile.data;
+    }
+
+    /* marks the beginning of the run: the time base of the dump and the calibration of the ticks */
+    static void start(){
+        clockStart();
+    }
+
+    static void dump(){
+        ProfileData data;
+        {
+            std::lock_guard<std::mutex> lock(mutex());
+            data = totals();
+        }
+        data.add(local());
+        /* the ticks are converted with the ratio of elapsed ticks to elapsed steady_clock time since start() */
+        const ClockStart& begin = clockStart();
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin.time).count();
+        double seconds_per_tick = seconds / (double)(profileTicks() - begin.ticks);
+
+        printf("\nProfile (%.3f s):\n", seconds);
+        printf("%-20s %12s %12s %10s %12s\n", "Phase", "Calls", "Total (s)", "% of run", "ns/call");
+        for (int i = 0; i < PROFILE_PHASES; i++) {
+            double total = data.ticks[i] * seconds_per_tick;
+            printf("%-20s %12llu %12.4f %9.2f%% %12.1f\n", profilePhaseName(i), (unsigned long long)data.calls[i],
+                   total, 100 * total / seconds, data.calls[i] ? 1e9 * total / data.calls[i] : 0.0);
+        }
+        printf("%-20s %12s %12s\n", "Counter", "Value", "per clean");
+        for (int i = 0; i < PROFILE_COUNTERS; i++) {
+            uint64_t cleans = data.counters[PROFILE_BLOCK_CLEANS];
+            printf("%-20s %12llu %12.3f\n", profileCounterName(i), (unsigned long long)data.counters[i],
+                   cleans ? (double)data.counters[i] / cleans : 0.0);
+        }
+        fflush(stdout);
+    }
+
+private:
+    class ClockStart{
+    public:
+        std::chrono::steady_clock::time_point time;
+        uint64_t ticks;
+
+        ClockStart() : time(std::chrono::steady_clock::now()), ticks(profileTicks()) {}
+    };
+
+    /* adds the profile of a thread to the process profile when the thread exits */
+    class ThreadProfile{
+    public:
+        ProfileData data;
+
+        ~ThreadProfile() {
+            std::lock_guard<std::mutex> lock(mutex());
+            totals().add(data);
+        }
+    };
+
+    static const ClockStart& clockStart(){
+        static ClockStart clock_start;
+        return clock_start;
+    }
+
+    static ProfileData& totals(){
+        static ProfileData data;
+        return data;
+    }
+
+    static std::mutex& mutex(){
+        static std::mutex profile_mutex;
+        return profile_mutex;
+    }
+};
+
+class ProfileScope{
+public:
+    ProfilePhase phase;
+    uint64_t start;
+
+    explicit ProfileScope(ProfilePhase phase) : phase(phase), start(profileTicks()) {}
+
+    ~ProfileScope() {
+        ProfileData& data = Profiler::local();
+        data.ticks[phase] += profileTicks() - start;
+        data.calls[phase]++;
+    }
+};
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_SCOPE(phase) ProfileScope PROFILE_CONCAT(profile_scope_, __LINE__)(phase)
+#define PROFILE_COUNT(counter, n) (Profiler::local().counters[counter] += (n))
+#define PROFILE_START() Profiler::start()
+#define PROFILE_DUMP() Profiler::dump()
+
+#else
+
+#define PROFILE_SCOPE(phase) ((void)0)
+#define PROFILE_COUNT(counter, n) ((void)0)
+#define PROFILE_START() ((void)0)
+#define PROFILE_DUMP() ((void)0)
+
+#endif //FLASHGC_PROFILE
+
+#endif //FLASHGC_PROFILER_H
@@ -0,0 +1,123 @@
+/*
+ *	Created by Eyal Lotan and Dor Sura.
+ */
+
+/*
+ *	ReplicaRunner runs R independent replicas of one simulation (Monte Carlo style) and summarizes them. Replica r
+ *	is seeded with seed+r, so the whole experiment is reproducible from the first seed, and the replicas run side by
+ *	side on a thread pool. Every replica owns its AlgoRunner, FTL and random number generators.
+ *	The first replica is built by the caller (interactively, so the user is asked for the parameters once) and the
+ *	others copy its parameters. The per replica results are printed followed by the mean, standard deviation, 95%
+ *	interval of the mean and percentiles of the erases and the WA of every algorithm.
+ *
+ *	USAGE:
+ *	./Simulator 64 50 32 4096 100000 window_off uniform greedy --replicas=16 --seed=1
+ */
+
+#ifndef FLASHGC_REPLICARUNNER_H
+#define FLASHGC_REPLICARUNNER_H
+
+#include <iostream>
+#include <vector>
+#include "AlgoRunner.h"
+#include "Statistics.h"
+#include "ThreadPool.h"
+
+/* the results of one replica, one entry per algorithm (several in lockstep mode) */
+class ReplicaResult{
+public:
+    unsigned long long seed;
+    vector<unsigned long long> erases;
+    vector<double> write_amplification;
+};
+
+class ReplicaRunner{
+public:
+    /* the runner of the first replica, owned by the caller */
+    AlgoRunner* first;
+
+    /* the simulated algorithms: several run in lockstep, a single one runs alone */
+    vector<Algorithm> algorithms;
+
+    int number_of_replicas;
+    int number_of_threads;
+    vector<ReplicaResult> results;
+
+    ReplicaRunner(AlgoRunner* first, const vector<Algorithm>& algorithms, int number_of_replicas,
+                  int number_of_threads) :
+                  first(first), algorithms(algorithms), number_of_replicas(number_of_replicas),
+                  number_of_threads(number_of_threads) {}
+
+    void run(){
+        results.resize(number_of_replicas);
+        ThreadPool pool(number_of_threads);
+        for (int r = 0; r < number_of_replicas; r++) {
+            pool.submit([this, r] {
+                if (r == 0){
+                    results[r] = runReplica(first);
+                    return;
+                }
+                /* only the first replica saves its steady state and records its time series */
+                UserParameters user_parameters = first->user_parameters;
+                user_parameters.save_snapshot.clear();
+                user_parameters.series_path.clear();
+                AlgoRunner* runner = new AlgoRunner(first->geometry, first->page_dist, first->algo, user_parameters,
+                                                    first->seed + r, false);
+                runner->setSteadyState(first->reach_steady_state);
+                results[r] = runReplica(runner);
+                delete runner;
+            });
+        }
+        pool.wait();
+    }
+
+    void printResults() const{
+        cout << "Replica\tSeed\tAlgorithm\tErases\tWrite Amplification" << endl;
+        for (int r = 0; r < number_of_replicas; r++) {
+            for (unsigned int k = 0; k < algorithms.size(); k++) {
+                cout << r << "\t" << results[r].seed << "\t" << algoEnumToString(algorithms[k]) << "\t"
+                     << results[r].erases[k] << "\t" << results[r].write_amplification[k] << endl;
+            }
+        }
+        cout << endl << "Summary of " << number_of_replicas << " replicas:" << endl;
+        cout << "Algorithm\tMetric\tMean\tStddev\t95% CI\tMin\tP5\tP50\tP95\tMax" << endl;
+        for (unsigned int k = 0; k < algorithms.size(); k++) {
+            SampleSummary erases, write_amplification;
+            for (const ReplicaResult& result : results) {
+                erases.add(result.erases[k]);
+                write_amplification.add(result.write_amplification[k]);
+            }
+            printSummary(algorithms[k], "Erases", erases);
+            printSummary(algorithms[k], "Write Amplification", write_amplification);
+        }
+    }
+
+private:
+    ReplicaResult runReplica(AlgoRunner* runner) const{
+        if (algorithms.size() > 1){
+            runner->runLockstepSimulation(algorithms);
+        }
+        else {
+            runner->runSimulation(algorithms[0]);
+        }
+        ReplicaResult result;
+        result.seed = runner->seed;
+        for (unsigned int k = 0; k < algorithms.size(); k++) {
+            const FTL* ftl = runner->measuredFTL(k);
+            unsigned long long logical_page_writes = ftl->logicalPageWrites - ftl->logicalPageWritesSteady;
+            unsigned long long physical_page_writes = ftl->physicalPageWrites - ftl->physicalPageWritesSteady;
+            result.erases.push_back(ftl->erases - ftl->erases_steady);
+            result.write_amplification.push_back((double)physical_page_writes / logical_page_writes);
+        }
+        return result;
+    }
+
+    static void printSummary(Algorithm algo, const char* metric, const SampleSummary& summary){
+        cout << algoEnumToString(algo) << "\t" << metric << "\t" << summary.mean() << "\t" << summary.stddev()
+             << "\t" << summary.halfWidth() << "\t" << summary.percentile(0) << "\t" << summary.percentile(5)
+             << "\t" << summary.percentile(50) << "\t" << summary.percentile(95) << "\t" << summary.percentile(100)
+             << endl;
+    }
+};
+
+#endif //FLASHGC_REPLICARUNNER_H
@@ -0,0 +1,162 @@
+/*
+ *	Created by Eyal Lotan and Dor Sura.
+ */
+
+/*
+ *	End to end benchmark of the simulator. Runs a fixed catalog of scenarios (every algorithm on the uniform and
+ *	hot/cold workloads, on a small, a medium and a large geometry) with fixed seeds and no interaction, and prints
+ *	one JSON document with the throughput, peak memory and results of every scenario, so the speed and the
+ *	results of the simulator can be tracked across versions.
+ *	Every scenario runs in its own child process: the peak RSS of a scenario is not hidden by the scenarios that ran
+ *	before it, and a scenario that crashes is reported instead of ending the benchmark.
+ *
+ *	Reported per scenario:
+ *	host_writes - all the simulated host writes: warmup_writes + measured_writes.
+ *	seconds, host_writes_per_second - wall time of the whole simulation, sequence generation and warmup included.
+ *	peak_rss_kb - maximum resident set size of the scenario process.
+ *	erases, write_amplification, write_amplification_ci - the results of the measurement phase, same as a sweep.
+ *
+ *	USAGE: ./SimulatorBenchmark [scenario name filter] > results.json
+ *	Scenario names are <geometry>_<distribution>_<algorithm>, e.g small_hot_cold_greedy. Only the scenarios whose
+ *	name contains the filter run.
+ */
+
+#include <cstdio>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "SweepRunner.h"
+
+using namespace std;
+
+/* SweepRunner.h refers to the help printer of the simulator */
+void printHelp() {}
+
+#define BENCHMARK_SEED "1"
+
+class Scenario{
+public:
+    string name;
+    SimulationConfig config;
+};
+
+class ScenarioResult{
+public:
+    bool ok;
+    SimulationResult result;
+    long peak_rss_kb;
+};
+
+/* the fixed catalog: geometry x distribution x algorithm */
+static vector<Scenario> buildCatalog(){
+    /* name, T, U, Z, N */
+    const char* geometries[][5] = {{"small", "64", "50", "32", "200000"},
+                                   {"medium", "256", "200", "64", "1000000"},
+                                   {"large", "1024", "900", "128", "2000000"}};
+    const char* distributions[] = {"uniform", "hot_cold"};
+    const char* algorithms[] = {"greedy", "greedy_lookahead", "generational", "writing_assignment", "oracle"};
+
+    vector<Scenario> catalog;
+    for (auto& geometry : geometries) {
+        for (const char* distribution : distributions) {
+            for (const char* algorithm : algorithms) {
+                map<string, string> point = {{"T", geometry[1]}, {"U", geometry[2]}, {"Z", geometry[3]},
+                                             {"N", geometry[4]}, {"page_size", "4096"}, {"algo", algorithm},
+                                             {"dist", distribution}, {"hot_percentage", "10"},
+                                             {"hot_probability", "0.9"}, {"window", "0"}, {"generations", "0"},
+                                             {"seed", BENCHMARK_SEED}, {"rng", "kiss"}, {"warmup", "0"},
+                                             {"ci_target", "0"}};
+                Scenario scenario;
+                scenario.name = string(geometry[0]) + "_" + distribution + "_" + algorithm;
+                if (!SweepRunner::makeConfig(point, &scenario.config)){
+                    exit(-1);
+                }
+                catalog.push_back(scenario);
+            }
+        }
+    }
+    return catalog;
+}
+
+/* runs the scenario in a child process. the child sends its SimulationResult back through a pipe, and the peak
+ * RSS of the child is taken from wait4 */
+static ScenarioResult runScenario(const Scenario& scenario){
+    ScenarioResult scenario_result = ScenarioResult();
+    int fds[2];
+    if (pipe(fds) != 0){
+        cerr << "Error! could not create a pipe." << endl;
+        exit(-1);
+    }
+    pid_t pid = fork();
+    if (pid < 0){
+        cerr << "Error! could not fork." << endl;
+        exit(-1);
+    }
+    if (pid == 0){
+        close(fds[0]);
+        /* stdout carries the JSON, messages of the simulation go to stderr */
+        dup2(2, 1);
+        SimulationResult result = SweepRunner::runSimulation(scenario.config);
+        ssize_t written = write(fds[1], &result, sizeof(result));
+        _exit(written == sizeof(result) ? 0 : 1);
+    }
+    close(fds[1]);
+    ssize_t bytes = read(fds[0], &scenario_result.result, sizeof(scenario_result.result));
+    close(fds[0]);
+    int status;
+    struct rusage usage;
+    if (wait4(pid, &status, 0, &usage) != pid){
+        cerr << "Error! wait4 failed." << endl;
+        exit(-1);
+    }
+    scenario_result.ok = WIFEXITED(status) && WEXITSTATUS(status) == 0 && bytes == sizeof(scenario_result.result);
+    /* kilobytes on linux */
+    scenario_result.peak_rss_kb = usage.ru_maxrss;
+    return scenario_result;
+}
+
+static void printScenario(const Scenario& scenario, const ScenarioResult& scenario_result, bool last){
+    const SimulationConfig& config = scenario.config;
+    const SimulationResult& result = scenario_result.result;
+    printf("    {\"name\": \"%s\", \"T\": %d, \"U\": %d, \"Z\": %d, \"N\": %llu, \"algorithm\": \"%s\", "
+           "\"distribution\": \"%s\", \"seed\": %llu, \"ok\": %s",
+           scenario.name.c_str(), config.geometry.physical_blocks, config.geometry.logical_blocks,
+           config.geometry.pages_per_block, config.geometry.number_of_pages, algoEnumToString(config.algo),
+           distributionEnumToString(config.page_dist), config.seed, scenario_result.ok ? "true" : "false");
+    if (scenario_result.ok){
+        unsigned long long host_writes = result.warmup_writes + result.logical_page_writes;
+        printf(", \"warmup_writes\": %llu, \"measured_writes\": %llu, \"host_writes\": %llu, \"seconds\": %.6f, "
+               "\"host_writes_per_second\": %.1f, \"peak_rss_kb\": %ld, \"erases\": %llu, "
+               "\"write_amplification\": %.6f, \"write_amplification_ci\": %.6f",
+               result.warmup_writes, result.logical_page_writes, host_writes, result.seconds,
+               host_writes / result.seconds, scenario_result.peak_rss_kb, result.erases, result.write_amplification,
+               result.write_amplification_ci);
+    }
+    printf("}%s\n", last ? "" : ",");
+}
+
+int main(int argc, char** argv) {
+    string filter = argc > 1 ? argv[1] : "";
+    vector<Scenario> scenarios;
+    for (const Scenario& scenario : buildCatalog()) {
+        if (scenario.name.find(filter) != string::npos){
+            scenarios.push_back(scenario);
+        }
+    }
+
+    printf("{\n  \"seed\": %s,\n  \"scenarios\": [\n", BENCHMARK_SEED);
+    fflush(stdout);
+    for (unsigned int i = 0; i < scenarios.size(); i++) {
+        cerr << "Running " << scenarios[i].name << "..." << endl;
+        ScenarioResult scenario_result = runScenario(scenarios[i]);
+        printScenario(scenarios[i], scenario_result, i + 1 == scenarios.size());
+        /* the child inherits the stdout buffer, so it is flushed before every fork */
+        fflush(stdout);
+    }
+    printf("  ]\n}\n");
+    return 0;
+}
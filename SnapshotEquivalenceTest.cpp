@@ -0,0 +1,96 @@
+/*
+ *	Created by Eyal Lotan and Dor Sura.
+ */
+
+/*
+ *	Checks that a steady state snapshot changes nothing: a uniform, a hot/cold and a trace simulation of the
+ *	64/50/32 geometry run once with their own warmup and once from a snapshot saved by the warmup of the sweep
+ *	(SweepRunner::warmUp), and the erases, logical writes, physical writes and WA of both runs must be exactly
+ *	the same.
+ *
+ *	USAGE: ./SnapshotEquivalenceTest (exits with 0 if the results match)
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <unistd.h>
+#include "SweepRunner.h"
+
+using namespace std;
+
+/* AlgoRunner.h refers to the help printer of the simulator */
+void printHelp() {}
+
+/* greedy on the 64/50/32 geometry, 100000 writes, no window */
+static SimulationConfig makeTestConfig(PageDistribution page_dist, const string& trace_path){
+    SimulationConfig config;
+    config.geometry = Geometry(64, 50, 32, 4096, 100000);
+    config.algo = GREEDY;
+    config.page_dist = page_dist;
+    config.user_parameters.hot_pages_percentage = 10;
+    config.user_parameters.hot_pages_probability = 0.9;
+    config.user_parameters.trace_path = trace_path;
+    config.user_parameters.window_size = config.geometry.number_of_pages;
+    config.seed = 7;
+    return config;
+}
+
+/* write a trace of 100000 random page writes over the logical pages of the 64/50/32 geometry */
+static bool writeTestTrace(const string& directory, const string& trace_path){
+    string text_path = directory + "/trace.txt";
+    ofstream text(text_path);
+    KissGenerator kiss_generator(3);
+    for (int i = 0; i < 100000; i++) {
+        text << kiss_generator() % (50 * 32) << "\n";
+    }
+    text.close();
+    bool converted = text && convertTextTrace(text_path, trace_path, TraceConversionOptions());
+    remove(text_path.c_str());
+    return converted;
+}
+
+static bool sameResult(const SimulationResult& warmup, const SimulationResult& snapshot){
+    return warmup.erases == snapshot.erases && warmup.logical_page_writes == snapshot.logical_page_writes &&
+           warmup.physical_page_writes == snapshot.physical_page_writes &&
+           warmup.write_amplification == snapshot.write_amplification;
+}
+
+int main() {
+    char directory_template[] = "/tmp/SnapshotEquivalenceTest.XXXXXX";
+    if (!mkdtemp(directory_template)){
+        cerr << "Error! can not create a temporary directory." << endl;
+        return 1;
+    }
+    string directory = directory_template;
+    string trace_path = directory + "/trace.bin";
+    string snapshot_path = directory + "/T64_U50_Z32_seed7.snapshot";
+    if (!writeTestTrace(directory, trace_path)){
+        return 1;
+    }
+
+    PageDistribution page_dists[] = {UNIFORM, HOT_COLD, TRACE};
+    const char* names[] = {"uniform", "hot_cold", "trace"};
+    int failures = 0;
+    for (int i = 0; i < 3; i++) {
+        SimulationConfig config = makeTestConfig(page_dists[i], trace_path);
+        SimulationResult warmup = SweepRunner::runSimulation(config);
+
+        /* the snapshot is saved by the warmup the sweep runs for every geometry, whatever the page_dist is */
+        config.user_parameters.load_snapshot = snapshot_path;
+        SweepRunner::warmUp(config);
+        SimulationResult snapshot = SweepRunner::runSimulation(config);
+        remove(snapshot_path.c_str());
+
+        cout << names[i] << ": warmup " << warmup.erases << " erases, WA " << warmup.write_amplification
+             << "; snapshot " << snapshot.erases << " erases, WA " << snapshot.write_amplification << endl;
+        if (!sameResult(warmup, snapshot)){
+            cerr << "Error! the results with and without the snapshot differ." << endl;
+            failures++;
+        }
+    }
+    remove(trace_path.c_str());
+    rmdir(directory.c_str());
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,154 @@
+/*
+ *	Created by Eyal Lotan and Dor Sura.
+ */
+
+/*
+ *	Statistics helpers of the simulator.
+ *
+ *	Batch means estimation of the write amplification. The measurement phase is cut into batches of equal numbers
+ *	of logical writes and the WA of every batch is one observation. Batches much longer than the correlation of the
+ *	FTL state are close to independent, so the confidence interval of the mean is the usual student t interval over
+ *	the batch WAs. With equal batch lengths the mean of the batch WAs is the WA of all the complete batches.
+ *
+ *	USAGE:
+ *	BatchMeans batch_means(batch_length);
+ *	after every write: batch_means.record(logical_writes, physical_writes);
+ *	if (batch_means.reached(0.01)) ... // the 95% interval is within +-1% of the mean
+ *
+ *	SampleSummary summarizes independent observations (e.g the WA of every replica of a simulation): mean, sample
+ *	standard deviation, 95% interval of the mean and percentiles.
+ */
+
+#ifndef FLASHGC_STATISTICS_H
+#define FLASHGC_STATISTICS_H
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+/* at least this many batches are measured before the interval is trusted */
+#define CI_MIN_BATCHES 10
+
+/* shortest batch, in logical writes */
+#define CI_MIN_BATCH_LENGTH 4096ULL
+
+/* 0.975 quantile of the student t distribution (two sided 95% interval) */
+inline double studentT975(unsigned long long degrees_of_freedom){
+    static const double quantiles[] = {12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+                                       2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+                                       2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042};
+    if (degrees_of_freedom == 0){
+        return INFINITY;
+    }
+    if (degrees_of_freedom <= 30){
+        return quantiles[degrees_of_freedom - 1];
+    }
+    /* the normal quantile with the first order correction is accurate to 1e-3 above 30 */
+    return 1.960 + 2.4 / degrees_of_freedom;
+}
+
+class BatchMeans{
+public:
+    /* logical writes per batch */
+    unsigned long long batch_length;
+
+    /* counters at the start of the current batch */
+    unsigned long long batch_logical_writes;
+    unsigned long long batch_physical_writes;
+
+    /* running mean and sum of squared deviations of the batch WAs (Welford) */
+    unsigned long long batches;
+    double batch_mean;
+    double m2;
+
+    explicit BatchMeans(unsigned long long batch_length) : batch_length(batch_length), batch_logical_writes(0),
+                                                           batch_physical_writes(0), batches(0), batch_mean(0),
+                                                           m2(0) {}
+
+    /* logical_writes and physical_writes are the measurement counters so far (starting from 0). closes the
+     * current batch if it is complete */
+    void record(unsigned long long logical_writes, unsigned long long physical_writes){
+        if (logical_writes - batch_logical_writes < batch_length){
+            return;
+        }
+        double wa = (double)(physical_writes - batch_physical_writes) / (logical_writes - batch_logical_writes);
+        batches++;
+        double delta = wa - batch_mean;
+        batch_mean += delta / batches;
+        m2 += delta * (wa - batch_mean);
+        batch_logical_writes = logical_writes;
+        batch_physical_writes = physical_writes;
+    }
+
+    double mean() const{
+        return batch_mean;
+    }
+
+    /* half width of the 95% confidence interval of the mean */
+    double halfWidth() const{
+        if (batches < 2){
+            return INFINITY;
+        }
+        return studentT975(batches - 1) * std::sqrt(m2 / (batches - 1) / batches);
+    }
+
+    /* true once there are enough batches and the interval is within +-relative_target of the mean */
+    bool reached(double relative_target) const{
+        return batches >= CI_MIN_BATCHES && halfWidth() <= relative_target * batch_mean;
+    }
+};
+
+class SampleSummary{
+public:
+    std::vector<double> values;
+
+    void add(double value){
+        values.push_back(value);
+    }
+
+    double mean() const{
+        double sum = 0;
+        for (double value : values) {
+            sum += value;
+        }
+        return values.empty() ? 0 : sum / values.size();
+    }
+
+    /* sample standard deviation (0 for less than two values) */
+    double stddev() const{
+        if (values.size() < 2){
+            return 0;
+        }
+        double average = mean();
+        double sum = 0;
+        for (double value : values) {
+            sum += (value - average) * (value - average);
+        }
+        return std::sqrt(sum / (values.size() - 1));
+    }
+
+    /* half width of the 95% confidence interval of the mean */
+    double halfWidth() const{
+        if (values.size() < 2){
+            return INFINITY;
+        }
+        return studentT975(values.size() - 1) * stddev() / std::sqrt((double)values.size());
+    }
+
+    /* p-th percentile, 0<=p<=100, linearly interpolated between the closest ranks */
+    double percentile(double p) const{
+        if (values.empty()){
+            return 0;
+        }
+        std::vector<double> sorted = values;
+        std::sort(sorted.begin(), sorted.end());
+        double rank = p / 100 * (sorted.size() - 1);
+        unsigned int below = (unsigned int)rank;
+        if (below + 1 >= sorted.size()){
+            return sorted.back();
+        }
+        return sorted[below] + (rank - below) * (sorted[below + 1] - sorted[below]);
+    }
+};
+
+#endif //FLASHGC_STATISTICS_H
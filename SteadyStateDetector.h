@@ -0,0 +1,156 @@
+/*
+ *	Created by Eyal Lotan and Dor Sura.
+ */
+
+/*
+ *	SteadyStateDetector decides when the warmup of the FTL is done. Instead of a fixed number of writes it watches
+ *	the warmup in windows of logical writes and compares every window to the one before it:
+ *	- the write amplification of the window (physical writes / logical writes done in the window).
+ *	- the shape of the V histogram (the fraction of full blocks with i valid pages, 0<=i<=Z), averaged over
+ *	  samples taken every Z writes of the window, compared by L1 distance.
+ *	Steady state is declared once both stay within their tolerance for STEADY_STATE_STABLE_WINDOWS windows in a
+ *	row. The window is one device worth of writes (T*Z, at least STEADY_STATE_MIN_WINDOW), so small devices
+ *	converge after a few thousand writes and large ones get as many writes as their size needs.
+ *
+ *	USAGE:
+ *	SteadyStateDetector detector(ftl);
+ *	while (!detector.converged()) {
+ *	    ftl->write(...);
+ *	    detector.recordWrite();
+ *	}
+ */
+
+#ifndef FLASHGC_STEADYSTATEDETECTOR_H
+#define FLASHGC_STEADYSTATEDETECTOR_H
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include "FTL.hpp"
+
+/* minimal window length, keeps the windowed WA of tiny devices from being dominated by noise */
+#define STEADY_STATE_MIN_WINDOW 32768ULL
+
+/* max relative change of the windowed write amplification between consecutive windows */
+#define STEADY_STATE_WA_TOLERANCE 0.01
+
+/* max L1 distance between the V histograms of consecutive windows */
+#define STEADY_STATE_HISTOGRAM_TOLERANCE 0.05
+
+/* number of consecutive stable windows needed */
+#define STEADY_STATE_STABLE_WINDOWS 3
+
+/* the warmup gives up (and reports it) after this many windows */
+#define STEADY_STATE_MAX_WINDOWS 200
+
+class SteadyStateDetector{
+public:
+    const FTL* ftl;
+
+    /* logical writes per window */
+    unsigned long long window_writes;
+
+    /* V is sampled every sample_interval writes */
+    unsigned long long sample_interval;
+
+    /* the first fill_writes writes fill the device and are not measured: GC only starts once the physical pages
+     * run out */
+    unsigned long long fill_writes;
+
+    /* number of writes recorded so far */
+    unsigned long long writes;
+
+    /* FTL counters at the start of the current window */
+    unsigned long long window_logical_writes;
+    unsigned long long window_physical_writes;
+
+    /* write amplification and normalized V histogram of the last completed window (-1 before the first one) */
+    double last_wa;
+    std::vector<double> last_histogram;
+
+    /* sum of the V samples of the current window */
+    std::vector<double> histogram;
+
+    int windows;
+    int stable_windows;
+
+    /* true once converged, false if the detector gave up after STEADY_STATE_MAX_WINDOWS windows */
+    bool stable;
+    bool done;
+
+    explicit SteadyStateDetector(const FTL* ftl) :
+                                 ftl(ftl),
+                                 window_writes(std::max((unsigned long long)ftl->geometry.physicalPages(),
+                                                        STEADY_STATE_MIN_WINDOW)),
+                                 sample_interval(ftl->geometry.pages_per_block),
+                                 fill_writes(ftl->geometry.physicalPages()), writes(0), window_logical_writes(0),
+                                 window_physical_writes(0), last_wa(-1),
+                                 histogram(ftl->geometry.pages_per_block + 1, 0), windows(0), stable_windows(0),
+                                 stable(false), done(false) {}
+
+    bool converged() const{
+        return done;
+    }
+
+    /* call after every warmup write */
+    void recordWrite(){
+        writes++;
+        if (writes < fill_writes){
+            return;
+        }
+        if (writes == fill_writes){
+            startWindow();
+            return;
+        }
+        unsigned long long window_position = writes - fill_writes;
+        if (window_position % sample_interval == 0){
+            for (int i = 0; i <= ftl->geometry.pages_per_block; i++) {
+                histogram[i] += ftl->V.size(i);
+            }
+        }
+        if (window_position % window_writes == 0){
+            endWindow();
+        }
+    }
+
+private:
+    void startWindow(){
+        window_logical_writes = ftl->logicalPageWrites;
+        window_physical_writes = ftl->physicalPageWrites;
+        std::fill(histogram.begin(), histogram.end(), 0);
+    }
+
+    void endWindow(){
+        double wa = (double)(ftl->physicalPageWrites - window_physical_writes) /
+                    (ftl->logicalPageWrites - window_logical_writes);
+        double total = 0;
+        for (double count : histogram) {
+            total += count;
+        }
+        for (double& count : histogram) {
+            count = total > 0 ? count / total : 0;
+        }
+
+        if (last_wa >= 0){
+            double distance = 0;
+            for (unsigned int i = 0; i < histogram.size(); i++) {
+                distance += std::fabs(histogram[i] - last_histogram[i]);
+            }
+            bool wa_stable = std::fabs(wa - last_wa) <= STEADY_STATE_WA_TOLERANCE * last_wa;
+            stable_windows = wa_stable && distance <= STEADY_STATE_HISTOGRAM_TOLERANCE ? stable_windows + 1 : 0;
+        }
+        last_wa = wa;
+        last_histogram = histogram;
+        windows++;
+        if (stable_windows >= STEADY_STATE_STABLE_WINDOWS){
+            stable = true;
+            done = true;
+        }
+        else if (windows >= STEADY_STATE_MAX_WINDOWS){
+            done = true;
+        }
+        startWindow();
+    }
+};
+
+#endif //FLASHGC_STEADYSTATEDETECTOR_H
@@ -0,0 +1,531 @@
+/*
+ *	Created by Eyal Lotan and Dor Sura.
+ */
+
+/*
+ *	SweepRunner runs a grid of simulations in one process. Every parameter of the grid takes a comma separated list
+ *	of values, and the sweep runs the cartesian product of all lists. The simulations run side by side on a
+ *	work-stealing thread pool: each task builds its own AlgoRunner/FTL instance for its geometry and runs it without
+ *	any interaction. When all tasks are done the results are printed
+ *	as one tab separated table, in grid order.
+ *
+ *	USAGE:
+ *	./Simulator sweep T=64,128 U=50,52 Z=32 N=100000 algo=greedy,greedy_lookahead dist=uniform threads=4
+ *
+ *	Parameters (defaults in brackets):
+ *	T, U, Z - physical blocks, logical blocks and pages per block. combinations with U >= T are skipped.
+ *	page_size [4096], N - page size in bytes and number of pages.
+ *	algo [greedy] - greedy, greedy_lookahead, generational, writing_assignment or oracle.
+ *	dist [uniform] - uniform, hot_cold or trace=<binary trace file>. hot_percentage [10] and hot_probability [0.9]
+ *	set the hot/cold workload.
+ *	window [0] - window size for the lookahead algorithms. 0 means no window.
+ *	generations [0] - number of generations for the generational algorithm. 0 selects it with the OF heuristic.
+ *	seed [1] - seed of the random number generator of every simulation.
+ *	rng [kiss] - generator of the writing sequence, kiss or philox. the sweep is already parallel, so every
+ *	sequence is generated on a single thread.
+ *	warmup [0] - number of warmup writes. 0 runs the warmup until the steady state is detected.
+ *	ci_target [0] - stop every simulation once the 95% confidence interval of its WA is within +-ci_target of the
+ *	mean. 0 measures all N writes.
+ *	candidate_depth [0], candidate_blocks [0] - the victim candidates of greedy_lookahead: the blocks with Y..Y+depth
+ *	valid pages (depth at most MAX_CANDIDATE_DEPTH), at most candidate_blocks of them (0 - no limit). the candidates
+ *	are scored on the simulation's thread.
+ *	threads [number of cores] - number of worker threads. takes a single value.
+ *	snapshots [none] - a directory for steady state snapshots. takes a single value. the warmup of every
+ *	(T, U, Z, seed, warmup) runs once and is saved there (or reused if it is already there), and every simulation of that
+ *	geometry starts from the snapshot instead of running its own warmup.
+ *	cache [none] - a directory of results. takes a single value. every completed simulation is saved there under the
+ *	FNV-1a hash of its full parameter set (a trace by its path, size and modification time), and a simulation whose result is already there is not run again, so adding
+ *	a point to a large sweep only runs the new configurations. bump RESULT_CACHE_VERSION when the results of the
+ *	simulator change.
+ *	spec=<file> - read the arguments from an experiment spec file: one key=values argument per line, '#' starts a
+ *	comment, and spaces are ignored. arguments given after it override the spec.
+ *
+ *	Spec file example:
+ *	# over provisioning study
+ *	T = 64
+ *	U = 48, 50, 52
+ *	Z = 32
+ *	N = 1000000
+ *	algo = greedy, generational
+ *	seed = 1, 2, 3
+ *	cache = results
+ */
+
+#ifndef FLASHGC_SWEEPRUNNER_H
+#define FLASHGC_SWEEPRUNNER_H
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <sys/stat.h>
+#include "AlgoRunner.h"
+#include "ThreadPool.h"
+
+/* version of the cached results. results cached with another version are ignored */
+#define RESULT_CACHE_VERSION 3
+
+/* a single point of the sweep grid */
+class SimulationConfig{
+public:
+    Geometry geometry;
+    Algorithm algo;
+    PageDistribution page_dist;
+    UserParameters user_parameters;
+    unsigned long long seed;
+
+    SimulationConfig() : geometry(0, 0, 0, 0, 0), algo(INVALID_ALGO), page_dist(INVALID_DIST), user_parameters(), seed(0) {}
+};
+
+class SimulationResult{
+public:
+    /* length of the simulated writing sequence (for a trace, the number of writes replayed) */
+    unsigned long long number_of_pages;
+    unsigned long long window_size;
+    unsigned long long erases;
+    unsigned long long logical_page_writes;
+    unsigned long long physical_page_writes;
+    double write_amplification;
+    /* half width of the 95% confidence interval of the WA (batch means) */
+    double write_amplification_ci;
+    /* number of writes the steady state warmup took */
+    unsigned long long warmup_writes;
+    double seconds;
+};
+
+class SweepRunner{
+public:
+    vector<SimulationConfig> configs;
+    vector<SimulationResult> results;
+    int number_of_threads;
+
+    /* directory of the steady state snapshots, empty if the simulations run their own warmup */
+    string snapshot_directory;
+
+    /* directory of the cached results, empty if every simulation runs */
+    string cache_directory;
+
+    /* number of results taken from the cache by the last run() */
+    unsigned int cached_results;
+
+    SweepRunner() : number_of_threads(ThreadPool::defaultSize()), cached_results(0) {}
+
+    /* parse the key=value[,value...] arguments (spec=<file> arguments are replaced by the lines of the file) and
+     * expand them to the list of configurations. returns false (after printing the reason) if an argument is invalid.
+     */
+    bool parseGrid(int argc, char** argv){
+        const string keys[] = {"T", "U", "Z", "page_size", "N", "algo", "dist", "hot_percentage", "hot_probability",
+                               "window", "generations", "seed", "rng", "warmup", "ci_target", "candidate_depth",
+                               "candidate_blocks"};
+        map<string, vector<string>> grid = {{"page_size", {"4096"}}, {"algo", {"greedy"}}, {"dist", {"uniform"}},
+                                            {"hot_percentage", {"10"}}, {"hot_probability", {"0.9"}},
+                                            {"window", {"0"}}, {"generations", {"0"}}, {"seed", {"1"}}, {"rng", {"kiss"}},
+                                            {"warmup", {"0"}}, {"ci_target", {"0"}}, {"candidate_depth", {"0"}},
+                                            {"candidate_blocks", {"0"}}};
+        vector<string> arguments;
+        for (int i = 0; i < argc; i++) {
+            if (strncmp(argv[i], "spec=", 5) == 0){
+                if (!readSpec(argv[i] + 5, &arguments)){
+                    return false;
+                }
+                continue;
+            }
+            arguments.push_back(argv[i]);
+        }
+        for (const string& argument : arguments) {
+            size_t equals = argument.find('=');
+            if (equals == string::npos || equals == 0 || equals == argument.size() - 1){
+                cerr << "Invalid sweep argument: " << argument << endl;
+                return false;
+            }
+            string key = argument.substr(0, equals);
+            vector<string> values = splitValues(argument.substr(equals + 1));
+            if (key == "threads"){
+                number_of_threads = atoi(values[0].c_str());
+                if (values.size() != 1 || number_of_threads < 1){
+                    cerr << "Error! threads takes a single positive value." << endl;
+                    return false;
+                }
+                continue;
+            }
+            if (key == "snapshots"){
+                snapshot_directory = argument.substr(equals + 1);
+                continue;
+            }
+            if (key == "cache"){
+                cache_directory = argument.substr(equals + 1);
+                continue;
+            }
+            if (std::find(std::begin(keys), std::end(keys), key) == std::end(keys)){
+                cerr << "Error! unknown sweep parameter " << key << "." << endl;
+                return false;
+            }
+            grid[key] = values;
+        }
+        for (auto key : keys) {
+            if (grid.find(key) == grid.end()){
+                cerr << "Error! missing sweep parameter " << key << "." << endl;
+                return false;
+            }
+        }
+
+        /* walk the cartesian product of all value lists, odometer style: the last key changes fastest */
+        const int number_of_keys = sizeof(keys) / sizeof(keys[0]);
+        vector<unsigned int> position(number_of_keys, 0);
+        while (true) {
+            map<string, string> point;
+            for (int k = 0; k < number_of_keys; k++) {
+                point[keys[k]] = grid[keys[k]][position[k]];
+            }
+            SimulationConfig config;
+            if (!makeConfig(point, &config)){
+                return false;
+            }
+            if (isValidConfig(config)){
+                configs.push_back(config);
+            }
+            int k = number_of_keys - 1;
+            while (k >= 0 && ++position[k] == grid[keys[k]].size()) {
+                position[k] = 0;
+                k--;
+            }
+            if (k < 0){
+                break;
+            }
+        }
+        return true;
+    }
+
+    /* run all configurations on the thread pool and collect the results. configurations with a cached result are
+     * not run */
+    void run(){
+        results.resize(configs.size());
+        vector<unsigned int> pending;
+        if (!cache_directory.empty()){
+            mkdir(cache_directory.c_str(), 0755);
+        }
+        for (unsigned int i = 0; i < configs.size(); i++) {
+            if (cache_directory.empty() || !loadCachedResult(configs[i], &results[i])){
+                pending.push_back(i);
+            }
+        }
+        cached_results = configs.size() - pending.size();
+
+        ThreadPool pool(number_of_threads);
+        if (!snapshot_directory.empty()){
+            prepareSnapshots(&pool, pending);
+        }
+        for (unsigned int i : pending) {
+            pool.submit([this, i] {
+                results[i] = runSimulation(configs[i]);
+                if (!cache_directory.empty()){
+                    storeCachedResult(configs[i], results[i]);
+                }
+            });
+        }
+        pool.wait();
+    }
+
+    void printResults() const{
+        cout << "T\tU\tZ\tN\tAlgorithm\tDistribution\tWindow\tGenerations\tCandidate Depth\tCandidate Blocks\tSeed\tRNG\t"
+                "Erases\tLogical Writes\t"
+                "Physical Writes\tWrite Amplification\tWA CI (95%)\tWarmup Writes\tTime (s)" << endl;
+        for (unsigned int i = 0; i < configs.size(); i++) {
+            const SimulationConfig& config = configs[i];
+            const SimulationResult& result = results[i];
+            cout << config.geometry.physical_blocks << "\t" << config.geometry.logical_blocks << "\t" << config.geometry.pages_per_block << "\t"
+                 << result.number_of_pages << "\t" << algoEnumToString(config.algo) << "\t"
+                 << distributionEnumToString(config.page_dist) << "\t" << result.window_size << "\t"
+                 << config.user_parameters.number_of_generations << "\t" << config.user_parameters.candidate_depth << "\t"
+                 << config.user_parameters.candidate_blocks << "\t" << config.seed << "\t"
+                 << generatorEnumToString(config.user_parameters.sequence_generator) << "\t" << result.erases
+                 << "\t" << result.logical_page_writes << "\t" << result.physical_page_writes << "\t"
+                 << result.write_amplification << "\t" << result.write_amplification_ci << "\t" << result.warmup_writes << "\t" << result.seconds << endl;
+        }
+    }
+
+    /* run a single simulation on the calling thread */
+    static SimulationResult runSimulation(const SimulationConfig& config){
+        auto start = std::chrono::steady_clock::now();
+        AlgoRunner* runner = new AlgoRunner(config.geometry, config.page_dist, config.algo, config.user_parameters,
+                                            config.seed, false);
+        runner->runSimulation(config.algo);
+        auto end = std::chrono::steady_clock::now();
+
+        SimulationResult result;
+        result.number_of_pages = runner->number_of_pages;
+        result.window_size = runner->user_parameters.window_size;
+        result.erases = runner->ftl->erases - runner->ftl->erases_steady;
+        result.logical_page_writes = runner->ftl->logicalPageWrites - runner->ftl->logicalPageWritesSteady;
+        result.physical_page_writes = runner->ftl->physicalPageWrites - runner->ftl->physicalPageWritesSteady;
+        result.write_amplification = (double)result.physical_page_writes / result.logical_page_writes;
+        result.write_amplification_ci = runner->batch_means[0].halfWidth();
+        result.warmup_writes = runner->ftl->logicalPageWritesSteady;
+        result.seconds = std::chrono::duration<double>(end - start).count();
+        delete runner;
+        return result;
+    }
+
+    /* run the warmup of every (T, U, Z, seed, warmup) of the pending configurations that has no snapshot yet, in
+     * parallel, and point every pending configuration to its snapshot
+     */
+    void prepareSnapshots(ThreadPool* pool, const vector<unsigned int>& pending){
+        mkdir(snapshot_directory.c_str(), 0755);
+        set<string> snapshots;
+        for (unsigned int i : pending) {
+            SimulationConfig& config = configs[i];
+            config.user_parameters.load_snapshot = snapshotPath(config);
+            struct stat file_stat;
+            if (snapshots.insert(config.user_parameters.load_snapshot).second &&
+                stat(config.user_parameters.load_snapshot.c_str(), &file_stat) != 0){
+                SimulationConfig warmup_config = config;
+                pool->submit([warmup_config] {
+                    warmUp(warmup_config);
+                });
+            }
+        }
+        pool->wait();
+    }
+
+    string snapshotPath(const SimulationConfig& config) const{
+        return snapshot_directory + "/T" + std::to_string(config.geometry.physical_blocks) + "_U" +
+               std::to_string(config.geometry.logical_blocks) + "_Z" + std::to_string(config.geometry.pages_per_block) +
+               "_seed" + std::to_string(config.seed) +
+               (config.user_parameters.warmup_writes ? "_warmup" + std::to_string(config.user_parameters.warmup_writes) : "") +
+               ".snapshot";
+    }
+
+    /* run the steady state warmup of a configuration and save it to config.user_parameters.load_snapshot.
+     * the warmup draws the same random numbers as the warmup inside the simulation whatever the page
+     * distribution is, so the snapshot is the steady state the simulation would have reached by itself.
+     */
+    static void warmUp(const SimulationConfig& config){
+        UserParameters user_parameters = config.user_parameters;
+        string path = user_parameters.load_snapshot;
+        user_parameters.load_snapshot.clear();
+        user_parameters.save_snapshot = path + ".tmp";
+        AlgoRunner* runner = new AlgoRunner(config.geometry, UNIFORM, GREEDY, user_parameters, config.seed, false);
+        runner->reachSteadyState();
+        delete runner;
+        if (rename(user_parameters.save_snapshot.c_str(), path.c_str()) != 0){
+            cerr << "Error! can not save steady state snapshot " << path << "." << endl;
+        }
+    }
+
+    /* the full parameter set of a configuration, as one canonical string. two configurations with the same key
+     * give the same result (snapshots and threads do not change results, see SnapshotEquivalenceTest and
+     * GeometryConcurrencyTest, so they are not part of it). a trace is
+     * identified by its path, size and modification time, so a trace that is converted again to the same path is
+     * a different configuration
+     */
+    static string cacheKey(const SimulationConfig& config){
+        const UserParameters& parameters = config.user_parameters;
+        std::ostringstream key;
+        key << std::setprecision(17) << "version=" << RESULT_CACHE_VERSION << " T=" << config.geometry.physical_blocks
+            << " U=" << config.geometry.logical_blocks << " Z=" << config.geometry.pages_per_block
+            << " page_size=" << config.geometry.page_size << " N=" << config.geometry.number_of_pages
+            << " algo=" << algoEnumToString(config.algo) << " dist=" << distributionEnumToString(config.page_dist)
+            << " trace=" << parameters.trace_path;
+        struct stat trace_stat;
+        if (!parameters.trace_path.empty() && stat(parameters.trace_path.c_str(), &trace_stat) == 0){
+            key << " trace_size=" << (long long)trace_stat.st_size << " trace_mtime=" << (long long)trace_stat.st_mtim.tv_sec
+                << "." << std::setfill('0') << std::setw(9) << (long)trace_stat.st_mtim.tv_nsec << std::setfill(' ');
+        }
+        key << " hot_percentage=" << parameters.hot_pages_percentage << " hot_probability=" << parameters.hot_pages_probability
+            << " window=" << parameters.window_size << " generations=" << parameters.number_of_generations
+            << " seed=" << config.seed << " rng=" << generatorEnumToString(parameters.sequence_generator)
+            << " warmup=" << parameters.warmup_writes << " ci_target=" << parameters.ci_target
+            << " candidate_depth=" << parameters.candidate_depth << " candidate_blocks=" << parameters.candidate_blocks;
+        return key.str();
+    }
+
+    /* 64 bit FNV-1a hash */
+    static unsigned long long fnv1a(const string& text){
+        unsigned long long hash = 14695981039346656037ULL;
+        for (unsigned char c : text) {
+            hash ^= c;
+            hash *= 1099511628211ULL;
+        }
+        return hash;
+    }
+
+    string cachePath(const SimulationConfig& config) const{
+        char name[32];
+        snprintf(name, sizeof(name), "%016llx", fnv1a(cacheKey(config)));
+        return cache_directory + "/" + name + ".result";
+    }
+
+    /* a result file holds the key of the configuration (checked on load, so a hash collision is a miss) and the
+     * fields of the result. returns false if there is no valid result for the configuration
+     */
+    bool loadCachedResult(const SimulationConfig& config, SimulationResult* result) const{
+        std::ifstream file(cachePath(config));
+        string key;
+        if (!file || !std::getline(file, key) || key != cacheKey(config)){
+            return false;
+        }
+        file >> result->number_of_pages >> result->window_size >> result->erases >> result->logical_page_writes
+             >> result->physical_page_writes >> result->write_amplification >> result->write_amplification_ci
+             >> result->warmup_writes >> result->seconds;
+        return !file.fail();
+    }
+
+    /* written to a temporary file and renamed, so an interrupted sweep never leaves a partial result behind */
+    void storeCachedResult(const SimulationConfig& config, const SimulationResult& result) const{
+        string path = cachePath(config);
+        string temporary_path = path + ".tmp";
+        FILE* file = fopen(temporary_path.c_str(), "w");
+        if (!file){
+            cerr << "Error! can not save result " << path << "." << endl;
+            return;
+        }
+        fprintf(file, "%s\n%llu %llu %llu %llu %llu %.17g %.17g %llu %.17g\n", cacheKey(config).c_str(),
+                result.number_of_pages, result.window_size, result.erases, result.logical_page_writes,
+                result.physical_page_writes, result.write_amplification, result.write_amplification_ci,
+                result.warmup_writes, result.seconds);
+        bool ok = !ferror(file);
+        if (fclose(file) != 0 || !ok || rename(temporary_path.c_str(), path.c_str()) != 0){
+            cerr << "Error! can not save result " << path << "." << endl;
+        }
+    }
+
+    /* build the configuration of a single point of the grid (one value per key). returns false (after printing the
+     * reason) if a value is invalid.
+     */
+    static bool makeConfig(map<string, string>& point, SimulationConfig* config){
+        config->geometry = Geometry(atoi(point["T"].c_str()), atoi(point["U"].c_str()), atoi(point["Z"].c_str()),
+                                    atoi(point["page_size"].c_str()), atoll(point["N"].c_str()));
+        config->algo = algoStringToEnum(point["algo"].c_str());
+        config->page_dist = distributionStringToEnum(point["dist"].c_str());
+        if (config->page_dist == TRACE){
+            config->user_parameters.trace_path = point["dist"].substr(strlen("trace="));
+        }
+        config->user_parameters.hot_pages_percentage = atoi(point["hot_percentage"].c_str());
+        config->user_parameters.hot_pages_probability = atof(point["hot_probability"].c_str());
+        config->user_parameters.window_size = atoll(point["window"].c_str());
+        config->user_parameters.number_of_generations = atoi(point["generations"].c_str());
+        config->user_parameters.warmup_writes = strtoull(point["warmup"].c_str(), nullptr, 10);
+        config->user_parameters.ci_target = atof(point["ci_target"].c_str());
+        config->user_parameters.sequence_generator = generatorStringToEnum(point["rng"].c_str());
+        config->user_parameters.generation_threads = 1;
+        config->user_parameters.candidate_depth = atoi(point["candidate_depth"].c_str());
+        config->user_parameters.candidate_blocks = atoi(point["candidate_blocks"].c_str());
+        config->seed = atoll(point["seed"].c_str());
+        if (config->geometry.physical_blocks <= 0 || config->geometry.logical_blocks <= 0 || config->geometry.pages_per_block <= 0 ||
+            config->geometry.page_size <= 0 || (config->geometry.number_of_pages == 0 && config->page_dist != TRACE)){
+            cerr << "Error! T, U, Z, page_size and N must be positive (N may be 0 to replay a whole trace)." << endl;
+            return false;
+        }
+        if (config->algo == INVALID_ALGO){
+            cerr << "Invalid Algorithm Parameter: " << point["algo"] << endl;
+            return false;
+        }
+        if (config->user_parameters.sequence_generator == INVALID_GENERATOR){
+            cerr << "Invalid random number generator: " << point["rng"] << endl;
+            return false;
+        }
+        if (config->page_dist == INVALID_DIST){
+            cerr << "Invalid Distribution Parameter: " << point["dist"] << endl;
+            return false;
+        }
+        if (config->user_parameters.hot_pages_percentage < 0 || config->user_parameters.hot_pages_percentage > 100){
+            cerr << "Error! Hot pages percentage must be in 0-100 range." << endl;
+            return false;
+        }
+        if (config->user_parameters.hot_pages_probability < 0 || config->user_parameters.hot_pages_probability > 1){
+            cerr << "Error! Hot pages probability must be in 0-1 range." << endl;
+            return false;
+        }
+        if (config->user_parameters.ci_target < 0 || config->user_parameters.ci_target >= 1){
+            cerr << "Error! ci_target must be in 0-1 range." << endl;
+            return false;
+        }
+        if (config->user_parameters.candidate_depth < 0 || config->user_parameters.candidate_depth > MAX_CANDIDATE_DEPTH){
+            cerr << "Error! candidate_depth must be in 0-" << MAX_CANDIDATE_DEPTH << " range." << endl;
+            return false;
+        }
+        if (config->user_parameters.candidate_blocks < 0){
+            cerr << "Error! candidate_blocks can not be negative." << endl;
+            return false;
+        }
+        if (config->user_parameters.window_size == 0 || config->user_parameters.window_size > config->geometry.number_of_pages){
+            config->user_parameters.window_size = config->geometry.number_of_pages;
+        }
+        return true;
+    }
+
+private:
+    static vector<string> splitValues(const string& values){
+        vector<string> res;
+        size_t begin = 0;
+        while (true) {
+            size_t comma = values.find(',', begin);
+            res.push_back(values.substr(begin, comma == string::npos ? string::npos : comma - begin));
+            if (comma == string::npos){
+                return res;
+            }
+            begin = comma + 1;
+        }
+    }
+
+    /* append the arguments of a spec file: one key=values per line, '#' starts a comment, spaces are ignored */
+    static bool readSpec(const char* path, vector<string>* arguments){
+        std::ifstream file(path);
+        if (!file){
+            cerr << "Error! can not read the spec file " << path << "." << endl;
+            return false;
+        }
+        string line;
+        while (std::getline(file, line)) {
+            line = line.substr(0, line.find('#'));
+            string argument;
+            for (char c : line) {
+                if (!isspace((unsigned char)c)){
+                    argument += c;
+                }
+            }
+            if (!argument.empty()){
+                arguments->push_back(argument);
+            }
+        }
+        return true;
+    }
+
+    /* combinations that the simulator can not run are skipped with a warning */
+    static bool isValidConfig(const SimulationConfig& config){
+        if (config.geometry.logical_blocks >= config.geometry.physical_blocks){
+            cerr << "Skipping T=" << config.geometry.physical_blocks << " U=" << config.geometry.logical_blocks << ": U must be smaller than T." << endl;
+            return false;
+        }
+        if (config.algo == GENERATIONAL && config.user_parameters.number_of_generations > config.geometry.physical_blocks - config.geometry.logical_blocks){
+            cerr << "Skipping T=" << config.geometry.physical_blocks << " U=" << config.geometry.logical_blocks << " generations="
+                 << config.user_parameters.number_of_generations << ": number of generations must be at most T-U." << endl;
+            return false;
+        }
+        return true;
+    }
+};
+
+/* entry point of the sweep mode: ./Simulator sweep <key=values>... */
+int runSweep(int argc, char** argv){
+    SweepRunner sweep;
+    if (!sweep.parseGrid(argc, argv)){
+        return -1;
+    }
+    cerr << "Running " << sweep.configs.size() << " simulations on " << sweep.number_of_threads << " threads..." << endl;
+    sweep.run();
+    if (!sweep.cache_directory.empty()){
+        cerr << sweep.cached_results << " of " << sweep.configs.size() << " results were taken from the cache." << endl;
+    }
+    sweep.printResults();
+    PROFILE_DUMP();
+    return 0;
+}
+
+#endif //FLASHGC_SWEEPRUNNER_H
@@ -0,0 +1,171 @@
+/*
+ *	Created by Eyal Lotan and Dor Sura.
+ */
+
+/*
+ *	A small work-stealing thread pool. Every worker owns a task queue: it pops its own tasks from the back, and
+ *	when its queue is empty it steals from the front of the other workers' queues. Tasks submitted from outside
+ *	the pool are spread round robin over the worker queues, tasks submitted by a worker go to its own queue.
+ *
+ *	USAGE:
+ *	ThreadPool pool(number_of_threads);
+ *	pool.submit([] {...});
+ *	pool.wait(); // blocks until all submitted tasks are done
+ */
+
+#ifndef FLASHGC_THREADPOOL_H
+#define FLASHGC_THREADPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ThreadPool{
+public:
+    class WorkerQueue{
+    public:
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    std::vector<WorkerQueue*> queues;
+    std::vector<std::thread> workers;
+
+    /* guards the sleeping/waking of workers and of wait() */
+    std::mutex mutex;
+    std::condition_variable work_available;
+    std::condition_variable all_done;
+
+    /* number of tasks that were submitted and not taken by a worker yet */
+    std::atomic<unsigned long long> queued;
+
+    /* number of tasks that were submitted and did not finish yet */
+    unsigned long long pending;
+
+    /* round robin counter for tasks submitted from outside the pool */
+    std::atomic<unsigned int> next_queue;
+
+    bool stop;
+
+    explicit ThreadPool(int number_of_threads) : queued(0), pending(0), next_queue(0), stop(false) {
+        if (number_of_threads < 1){
+            number_of_threads = 1;
+        }
+        for (int i = 0; i < number_of_threads; i++) {
+            queues.push_back(new WorkerQueue);
+        }
+        for (int i = 0; i < number_of_threads; i++) {
+            workers.emplace_back(&ThreadPool::workerLoop, this, i);
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stop = true;
+        }
+        work_available.notify_all();
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        for (auto queue : queues) {
+            delete queue;
+        }
+    }
+
+    int size() const{
+        return workers.size();
+    }
+
+    /* the default number of threads: one per core */
+    static int defaultSize(){
+        unsigned int cores = std::thread::hardware_concurrency();
+        return cores > 0 ? cores : 1;
+    }
+
+    void submit(std::function<void()> task){
+        int index = currentPool() == this ? currentWorker() : next_queue++ % queues.size();
+        /* counted before it is published: once it is in the queue a worker can take and finish it at once, and
+         * pending and queued must not drop below the tasks that are still to run
+         */
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            pending++;
+            queued++;
+        }
+        {
+            std::lock_guard<std::mutex> lock(queues[index]->mutex);
+            queues[index]->tasks.push_back(std::move(task));
+        }
+        work_available.notify_one();
+    }
+
+    /* block until every submitted task is done */
+    void wait(){
+        std::unique_lock<std::mutex> lock(mutex);
+        all_done.wait(lock, [this] { return pending == 0; });
+    }
+
+private:
+    /* the pool and worker index of the calling thread (nullptr and -1 outside of any pool) */
+    static ThreadPool*& currentPool(){
+        static thread_local ThreadPool* pool = nullptr;
+        return pool;
+    }
+
+    static int& currentWorker(){
+        static thread_local int worker = -1;
+        return worker;
+    }
+
+    bool popOwn(int index, std::function<void()>* task){
+        std::lock_guard<std::mutex> lock(queues[index]->mutex);
+        if (queues[index]->tasks.empty()){
+            return false;
+        }
+        *task = std::move(queues[index]->tasks.back());
+        queues[index]->tasks.pop_back();
+        return true;
+    }
+
+    bool steal(int index, std::function<void()>* task){
+        for (unsigned int i = 1; i < queues.size(); i++) {
+            WorkerQueue* victim = queues[(index + i) % queues.size()];
+            std::lock_guard<std::mutex> lock(victim->mutex);
+            if (!victim->tasks.empty()){
+                *task = std::move(victim->tasks.front());
+                victim->tasks.pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void workerLoop(int index){
+        currentPool() = this;
+        currentWorker() = index;
+        while (true) {
+            std::function<void()> task;
+            if (popOwn(index, &task) || steal(index, &task)){
+                queued--;
+                task();
+                std::lock_guard<std::mutex> lock(mutex);
+                if (--pending == 0){
+                    all_done.notify_all();
+                }
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(mutex);
+            work_available.wait(lock, [this] { return stop || queued > 0; });
+            if (stop && queued == 0){
+                return;
+            }
+        }
+    }
+};
+
+#endif //FLASHGC_THREADPOOL_H
@@ -0,0 +1,220 @@
+/*
+ *	Created by Eyal Lotan and Dor Sura.
+ */
+
+/*
+ *	TimeSeriesRecorder records the evolution of the FTL while the simulator runs: every 'interval' erases it
+ *	samples the number of erases, the number of logical writes, Y and the V histogram (the number of full blocks
+ *	with i valid pages, 0<=i<=Z). It replaces the old print mode, which printed a line through cout on every erase
+ *	and dominated the run time.
+ *	Samples are stored column by column in blocks of SERIES_BLOCK_ROWS rows. A full block is handed to a writer
+ *	thread and the simulation goes on filling a second block, so formatting and writing the file overlap with the
+ *	simulation and a sample costs a few stores.
+ *
+ *	The file format is chosen by the extension of the path:
+ *	.csv - a header line (Erases,Logical Writes,Y,V[0],...,V[Z]) and one line per sample.
+ *	anything else - binary: the magic "FGCSERI\0", then int32 SERIES_VERSION and Z, then the blocks. A block is
+ *	int32 rows followed by the columns: uint64 erases[rows], uint64 logical_writes[rows], int32 Y[rows],
+ *	int32 V[0][rows], ..., int32 V[Z][rows]. All values are little endian.
+ *
+ *	USAGE:
+ *	TimeSeriesRecorder* recorder = TimeSeriesRecorder::open("series.csv", Z, interval);
+ *	ftl->recorder = recorder;
+ *	... run the simulation ...
+ *	delete recorder; // writes the last block and closes the file
+ */
+
+#ifndef FLASHGC_TIMESERIESRECORDER_H
+#define FLASHGC_TIMESERIESRECORDER_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "ValidBuckets.h"
+
+/* samples per column block */
+#define SERIES_BLOCK_ROWS 4096
+
+#define SERIES_MAGIC "FGCSERI"
+#define SERIES_VERSION 1
+
+class TimeSeriesRecorder{
+public:
+    /* one block of samples, column by column */
+    class SeriesBlock{
+    public:
+        int rows;
+        std::vector<uint64_t> erases;
+        std::vector<uint64_t> logical_writes;
+        std::vector<int32_t> y;
+        /* valid[i * SERIES_BLOCK_ROWS + row] is V[i] of sample row */
+        std::vector<int32_t> valid;
+
+        explicit SeriesBlock(int pages_per_block) : rows(0), erases(SERIES_BLOCK_ROWS),
+                                                    logical_writes(SERIES_BLOCK_ROWS), y(SERIES_BLOCK_ROWS),
+                                                    valid((pages_per_block + 1) * SERIES_BLOCK_ROWS) {}
+    };
+
+    /* opens the file and starts the writer thread. returns nullptr (after printing the reason) if the file can
+     * not be created. an interval of 0 samples every erase
+     */
+    static TimeSeriesRecorder* open(const std::string& path, int pages_per_block, unsigned long long interval){
+        bool csv = path.size() >= 4 && path.compare(path.size() - 4, 4, ".csv") == 0;
+        FILE* file = fopen(path.c_str(), csv ? "w" : "wb");
+        if (!file){
+            std::cerr << "Error! can not create time series file " << path << "." << std::endl;
+            return nullptr;
+        }
+        return new TimeSeriesRecorder(file, csv, pages_per_block, interval ? interval : 1);
+    }
+
+    ~TimeSeriesRecorder() {
+        if (filling->rows > 0){
+            submit(filling);
+        }
+        else {
+            delete filling;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stop = true;
+        }
+        block_ready.notify_one();
+        writer.join();
+        for (SeriesBlock* block : free_blocks) {
+            delete block;
+        }
+        if (ferror(file) | fclose(file)){
+            std::cerr << "Error! writing the time series file failed." << std::endl;
+        }
+    }
+
+    /* call on every erase. samples the FTL counters every interval erases */
+    void record(unsigned long long erases, unsigned long long logical_writes, int y, const ValidBuckets& V){
+        if (erases % interval != 0){
+            return;
+        }
+        int row = filling->rows;
+        filling->erases[row] = erases;
+        filling->logical_writes[row] = logical_writes;
+        filling->y[row] = y;
+        for (int i = 0; i <= pages_per_block; i++) {
+            filling->valid[i * SERIES_BLOCK_ROWS + row] = V.size(i);
+        }
+        if (++filling->rows == SERIES_BLOCK_ROWS){
+            submit(filling);
+            filling = takeFreeBlock();
+        }
+    }
+
+private:
+    FILE* file;
+    bool csv;
+    int pages_per_block;
+    unsigned long long interval;
+
+    /* the block the simulation fills */
+    SeriesBlock* filling;
+
+    /* full blocks waiting for the writer, and written blocks ready for reuse */
+    std::deque<SeriesBlock*> full_blocks;
+    std::vector<SeriesBlock*> free_blocks;
+    std::mutex mutex;
+    std::condition_variable block_ready;
+    std::condition_variable block_free;
+    bool stop;
+    std::thread writer;
+
+    TimeSeriesRecorder(FILE* file, bool csv, int pages_per_block, unsigned long long interval) :
+                       file(file), csv(csv), pages_per_block(pages_per_block), interval(interval),
+                       filling(new SeriesBlock(pages_per_block)), free_blocks(1, new SeriesBlock(pages_per_block)),
+                       stop(false) {
+        writeHeader();
+        writer = std::thread(&TimeSeriesRecorder::writeLoop, this);
+    }
+
+    void submit(SeriesBlock* block){
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            full_blocks.push_back(block);
+        }
+        block_ready.notify_one();
+    }
+
+    /* waits only if the writer is a whole block behind the simulation */
+    SeriesBlock* takeFreeBlock(){
+        std::unique_lock<std::mutex> lock(mutex);
+        block_free.wait(lock, [this] { return !free_blocks.empty(); });
+        SeriesBlock* block = free_blocks.back();
+        free_blocks.pop_back();
+        block->rows = 0;
+        return block;
+    }
+
+    void writeLoop(){
+        while (true) {
+            SeriesBlock* block;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                block_ready.wait(lock, [this] { return stop || !full_blocks.empty(); });
+                if (full_blocks.empty()){
+                    return;
+                }
+                block = full_blocks.front();
+                full_blocks.pop_front();
+            }
+            writeBlock(block);
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                free_blocks.push_back(block);
+            }
+            block_free.notify_one();
+        }
+    }
+
+    void writeHeader(){
+        if (csv){
+            fprintf(file, "Erases,Logical Writes,Y");
+            for (int i = 0; i <= pages_per_block; i++) {
+                fprintf(file, ",V[%d]", i);
+            }
+            fprintf(file, "\n");
+            return;
+        }
+        char magic[8] = SERIES_MAGIC;
+        int32_t header[] = {SERIES_VERSION, pages_per_block};
+        fwrite(magic, sizeof(magic), 1, file);
+        fwrite(header, sizeof(header), 1, file);
+    }
+
+    void writeBlock(const SeriesBlock* block){
+        int rows = block->rows;
+        if (csv){
+            for (int row = 0; row < rows; row++) {
+                fprintf(file, "%llu,%llu,%d", (unsigned long long)block->erases[row],
+                        (unsigned long long)block->logical_writes[row], block->y[row]);
+                for (int i = 0; i <= pages_per_block; i++) {
+                    fprintf(file, ",%d", block->valid[i * SERIES_BLOCK_ROWS + row]);
+                }
+                fprintf(file, "\n");
+            }
+            return;
+        }
+        int32_t block_rows = rows;
+        fwrite(&block_rows, sizeof(block_rows), 1, file);
+        fwrite(block->erases.data(), sizeof(uint64_t), rows, file);
+        fwrite(block->logical_writes.data(), sizeof(uint64_t), rows, file);
+        fwrite(block->y.data(), sizeof(int32_t), rows, file);
+        for (int i = 0; i <= pages_per_block; i++) {
+            fwrite(block->valid.data() + i * SERIES_BLOCK_ROWS, sizeof(int32_t), rows, file);
+        }
+    }
+};
+
+#endif //FLASHGC_TIMESERIESRECORDER_H
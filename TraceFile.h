@@ -0,0 +1,350 @@
+/*
+ *	Created by Eyal Lotan and Dor Sura.
+ */
+
+/*
+ *	Binary trace files, used to replay real block I/O traces through the FTL instead of a synthetic writing
+ *	sequence.
+ *
+ *	Format (native little endian):
+ *	TraceHeader (32 bytes)  - magic "FGCTRACE", version, flags, number of entries, number of writes and the
+ *	                          number of logical pages the writes address (max written LPN + 1).
+ *	uint32 lpn[count]       - the logical page number of every entry.
+ *	uint8 op[count]         - only if TRACE_HAS_OPS is set: the op type of every entry (TRACE_OP_WRITE/READ).
+ *
+ *	A trace without ops is a plain LPN array, so it is replayed zero-copy: the file is mapped with mmap and the
+ *	WorkloadStream reads the mapping directly. A trace with ops is streamed through TraceSequenceSource, which
+ *	skips the non-write entries.
+ *	convertTextTrace() converts text traces (MSR Cambridge / SNIA style CSV, "op,offset,size" lines or plain LPN
+ *	lines) to this format, so a trace is parsed once instead of on every run.
+ */
+
+#ifndef FLASHGC_TRACEFILE_H
+#define FLASHGC_TRACEFILE_H
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "MyRand.h"
+
+#define TRACE_MAGIC "FGCTRACE"
+#define TRACE_VERSION 1
+
+/* header flags */
+#define TRACE_HAS_OPS 0x1u
+
+/* op types */
+#define TRACE_OP_WRITE 0
+#define TRACE_OP_READ 1
+
+/* LPNs above this collide with the FREE_PAGE/OBSOLETE_PAGE sentinels of the FTL mapping tables */
+#define TRACE_MAX_LPN 0xFFFFFFFDULL
+
+class TraceHeader{
+public:
+    char magic[8];
+    uint32_t version;
+    uint32_t flags;
+    uint64_t count;
+    uint64_t writes;
+    uint32_t number_of_logical_pages;
+    uint32_t reserved;
+};
+
+/* a read only memory mapping of a binary trace file */
+class MappedTrace{
+public:
+    std::string path;
+    const TraceHeader* header;
+    const uint32_t* lpns;
+
+    /* nullptr if the trace has no op types */
+    const uint8_t* ops;
+
+    void* mapping;
+    size_t mapping_size;
+
+    /* map the trace file. exits with an error message if the file is missing or not a valid trace */
+    explicit MappedTrace(const std::string& path) : path(path), header(nullptr), lpns(nullptr), ops(nullptr),
+                                                    mapping(nullptr), mapping_size(0) {
+        int fd = open(path.c_str(), O_RDONLY);
+        struct stat file_stat;
+        if (fd < 0 || fstat(fd, &file_stat) != 0){
+            cerr << "Error! can not open trace file " << path << "." << endl;
+            exit(-1);
+        }
+        mapping_size = file_stat.st_size;
+        if (mapping_size < sizeof(TraceHeader)){
+            cerr << "Error! " << path << " is not a trace file." << endl;
+            exit(-1);
+        }
+        mapping = mmap(nullptr, mapping_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (mapping == MAP_FAILED){
+            cerr << "Error! can not map trace file " << path << "." << endl;
+            exit(-1);
+        }
+        madvise(mapping, mapping_size, MADV_SEQUENTIAL);
+
+        header = (const TraceHeader*)mapping;
+        if (memcmp(header->magic, TRACE_MAGIC, sizeof(header->magic)) != 0 || header->version != TRACE_VERSION){
+            cerr << "Error! " << path << " is not a trace file (or was written by another version)." << endl;
+            exit(-1);
+        }
+        uint64_t expected_size = sizeof(TraceHeader) + header->count * sizeof(uint32_t) +
+                                 (hasOps() ? header->count : 0);
+        if (mapping_size < expected_size){
+            cerr << "Error! trace file " << path << " is truncated." << endl;
+            exit(-1);
+        }
+        lpns = (const uint32_t*)((const char*)mapping + sizeof(TraceHeader));
+        if (hasOps()){
+            ops = (const uint8_t*)(lpns + header->count);
+        }
+    }
+
+    ~MappedTrace() {
+        munmap(mapping, mapping_size);
+    }
+
+    bool hasOps() const{
+        return header->flags & TRACE_HAS_OPS;
+    }
+
+    /* number of write entries, i.e the length of the writing sequence the trace replays */
+    unsigned long long numberOfWrites() const{
+        return header->writes;
+    }
+
+    unsigned int numberOfLogicalPages() const{
+        return header->number_of_logical_pages;
+    }
+};
+
+/* the write entries of a trace with op types, in trace order */
+class TraceSequenceSource : public WritingSequenceSource {
+public:
+    const MappedTrace* trace;
+
+    /* next trace entry to look at */
+    unsigned long long position;
+
+    explicit TraceSequenceSource(const MappedTrace* trace) : trace(trace), position(0) {}
+
+    void generate(unsigned int* buffer, unsigned long long count) override {
+        unsigned long long i = 0;
+        while (i < count) {
+            if (trace->ops[position] == TRACE_OP_WRITE){
+                buffer[i++] = trace->lpns[position];
+            }
+            position++;
+        }
+    }
+};
+
+/* options of the text trace converter */
+class TraceConversionOptions{
+public:
+    /* bytes per logical page, used to turn byte offsets into LPNs */
+    unsigned int page_size;
+
+    /* renumber the LPNs densely (0,1,2,... in order of first appearance) so sparse traces fit a small device */
+    bool compact;
+
+    /* keep the read entries and store the op type of every entry. otherwise only the writes are kept */
+    bool keep_ops;
+
+    TraceConversionOptions() : page_size(4096), compact(false), keep_ops(false) {}
+};
+
+/* split a csv line to its fields */
+inline std::vector<std::string> splitCsvLine(const std::string& line){
+    std::vector<std::string> fields;
+    size_t begin = 0;
+    while (true) {
+        size_t comma = line.find(',', begin);
+        size_t end = comma == std::string::npos ? line.size() : comma;
+        while (begin < end && isspace((unsigned char)line[begin])) {
+            begin++;
+        }
+        while (end > begin && isspace((unsigned char)line[end - 1])) {
+            end--;
+        }
+        fields.push_back(line.substr(begin, end - begin));
+        if (comma == std::string::npos){
+            return fields;
+        }
+        begin = comma + 1;
+    }
+}
+
+/* op type of a text trace field ("Write", "W", "Read", "R", ...). returns -1 if unknown */
+inline int parseTraceOp(const std::string& field){
+    if (field.empty()){
+        return -1;
+    }
+    char op = tolower((unsigned char)field[0]);
+    if (op == 'w'){
+        return TRACE_OP_WRITE;
+    }
+    if (op == 'r'){
+        return TRACE_OP_READ;
+    }
+    return -1;
+}
+
+/* convert a text trace to the binary format. every line is one request, in one of the formats:
+ * Timestamp,Hostname,DiskNumber,Type,Offset,Size[,...]   (MSR Cambridge / SNIA style, offsets in bytes)
+ * Type,Offset,Size                                        (offsets in bytes)
+ * LPN                                                     (one page write per line)
+ * a request of several pages is expanded to its consecutive LPNs. lines that can not be parsed (e.g headers)
+ * are skipped. returns false on I/O errors or LPNs that do not fit 32 bits.
+ */
+inline bool convertTextTrace(const std::string& input_path, const std::string& output_path,
+                             const TraceConversionOptions& options){
+    std::ifstream input(input_path);
+    if (!input){
+        cerr << "Error! can not open " << input_path << "." << endl;
+        return false;
+    }
+    FILE* output = fopen(output_path.c_str(), "wb");
+    if (!output){
+        cerr << "Error! can not create " << output_path << "." << endl;
+        return false;
+    }
+
+    TraceHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, TRACE_MAGIC, sizeof(header.magic));
+    header.version = TRACE_VERSION;
+    header.flags = options.keep_ops ? TRACE_HAS_OPS : 0;
+    fwrite(&header, sizeof(header), 1, output);
+
+    std::unordered_map<unsigned long long, uint32_t> compact_lpns;
+    std::vector<uint8_t> ops;
+    std::vector<uint32_t> buffer;
+    unsigned long long max_lpn = 0;
+    unsigned long long skipped_lines = 0;
+    std::string line;
+    while (std::getline(input, line)) {
+        std::vector<std::string> fields = splitCsvLine(line);
+        int op;
+        unsigned long long first_page, last_page;
+        char* end;
+        if (fields.size() >= 6 || fields.size() == 3){
+            int op_field = fields.size() == 3 ? 0 : 3;
+            op = parseTraceOp(fields[op_field]);
+            unsigned long long offset = strtoull(fields[op_field + 1].c_str(), &end, 10);
+            bool valid = op >= 0 && *end == '\0' && !fields[op_field + 1].empty();
+            unsigned long long size = strtoull(fields[op_field + 2].c_str(), &end, 10);
+            if (!valid || *end != '\0' || size == 0){
+                skipped_lines++;
+                continue;
+            }
+            first_page = offset / options.page_size;
+            last_page = (offset + size - 1) / options.page_size;
+        }
+        else if (fields.size() == 1 && !fields[0].empty()){
+            op = TRACE_OP_WRITE;
+            first_page = strtoull(fields[0].c_str(), &end, 10);
+            if (*end != '\0'){
+                skipped_lines++;
+                continue;
+            }
+            last_page = first_page;
+        }
+        else {
+            skipped_lines++;
+            continue;
+        }
+        if (op != TRACE_OP_WRITE && !options.keep_ops){
+            continue;
+        }
+
+        for (unsigned long long page = first_page; page <= last_page; page++) {
+            unsigned long long lpn = page;
+            if (options.compact){
+                auto inserted = compact_lpns.insert({page, (uint32_t)compact_lpns.size()});
+                lpn = inserted.first->second;
+            }
+            if (lpn > TRACE_MAX_LPN){
+                cerr << "Error! LPN " << lpn << " does not fit in 32 bits. Use --compact." << endl;
+                fclose(output);
+                return false;
+            }
+            buffer.push_back(lpn);
+            if (options.keep_ops){
+                ops.push_back(op);
+            }
+            header.count++;
+            if (op == TRACE_OP_WRITE){
+                header.writes++;
+                max_lpn = std::max(max_lpn, lpn);
+            }
+        }
+        if (buffer.size() >= (1 << 20)){
+            fwrite(buffer.data(), sizeof(uint32_t), buffer.size(), output);
+            buffer.clear();
+        }
+    }
+    fwrite(buffer.data(), sizeof(uint32_t), buffer.size(), output);
+    fwrite(ops.data(), sizeof(uint8_t), ops.size(), output);
+
+    header.number_of_logical_pages = header.writes ? max_lpn + 1 : 0;
+    fseek(output, 0, SEEK_SET);
+    fwrite(&header, sizeof(header), 1, output);
+    bool ok = !ferror(output);
+    fclose(output);
+    if (!ok){
+        cerr << "Error! failed writing " << output_path << "." << endl;
+        return false;
+    }
+    cout << "Converted " << input_path << " to " << output_path << ": " << header.count << " entries, "
+         << header.writes << " writes, " << header.number_of_logical_pages << " logical pages";
+    if (skipped_lines){
+        cout << " (" << skipped_lines << " lines skipped)";
+    }
+    cout << "." << endl;
+    return true;
+}
+
+/* entry point of the converter: ./Simulator convert <input> <output> [page_size=<bytes>] [--compact] [--with-ops] */
+inline int runTraceConversion(int argc, char** argv){
+    if (argc < 2){
+        cerr << "Usage: convert <input> <output> [page_size=<bytes>] [--compact] [--with-ops]" << endl;
+        return -1;
+    }
+    TraceConversionOptions options;
+    for (int i = 2; i < argc; i++) {
+        if (strncmp(argv[i], "page_size=", 10) == 0){
+            options.page_size = atoi(argv[i] + 10);
+        }
+        else if (strcmp(argv[i], "--compact") == 0){
+            options.compact = true;
+        }
+        else if (strcmp(argv[i], "--with-ops") == 0){
+            options.keep_ops = true;
+        }
+        else {
+            cerr << "Invalid convert option: " << argv[i] << endl;
+            return -1;
+        }
+    }
+    if (options.page_size == 0){
+        cerr << "Error! page size must be positive." << endl;
+        return -1;
+    }
+    return convertTextTrace(argv[0], argv[1], options) ? 0 : -1;
+}
+
+#endif //FLASHGC_TRACEFILE_H
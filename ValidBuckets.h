@@ -0,0 +1,169 @@
+/*
+ *	Created by Eyal Lotan and Dor Sura.
+ */
+
+/*
+ *	ValidBuckets groups the full blocks of the FTL by their number of valid pages. bucket i, 0<=i<=Z,
+ *	holds all blocks with exactly i valid pages.
+ *	The buckets are intrusive doubly linked lists threaded through per-block prev/next arrays, so inserting,
+ *	removing and moving a block between buckets is O(1) and never allocates. The lowest non empty bucket is
+ *	tracked as well: it can only go down on insert/move, and is lazily advanced when that bucket empties.
+ */
+
+#ifndef FLASHGC_VALIDBUCKETS_H
+#define FLASHGC_VALIDBUCKETS_H
+
+#include <cassert>
+
+#define NO_BLOCK -1
+
+class ValidBuckets{
+public:
+    /* number of blocks that can be stored (T) */
+    int number_of_blocks;
+
+    /* highest bucket index (Z) */
+    int max_valid;
+
+    /* first and last block of every bucket, NO_BLOCK for an empty bucket */
+    int* head;
+    int* tail;
+
+    /* number of blocks in every bucket */
+    int* bucket_size;
+
+    /* per block links inside its bucket, NO_BLOCK at the ends */
+    int* prev;
+    int* next;
+
+    /* the bucket each block is in, NO_BLOCK if the block is not in any bucket (free or open blocks) */
+    int* bucket_of;
+
+    /* all buckets below min_valid are empty */
+    int min_valid;
+
+    ValidBuckets(int number_of_blocks, int max_valid) :
+                 number_of_blocks(number_of_blocks), max_valid(max_valid), head(new int[max_valid + 1]),
+                 tail(new int[max_valid + 1]), bucket_size(new int[max_valid + 1]), prev(new int[number_of_blocks]),
+                 next(new int[number_of_blocks]), bucket_of(new int[number_of_blocks]), min_valid(max_valid + 1) {
+        for (int i = 0; i <= max_valid; i++) {
+            head[i] = NO_BLOCK;
+            tail[i] = NO_BLOCK;
+            bucket_size[i] = 0;
+        }
+        for (int i = 0; i < number_of_blocks; i++) {
+            prev[i] = NO_BLOCK;
+            next[i] = NO_BLOCK;
+            bucket_of[i] = NO_BLOCK;
+        }
+    }
+
+    ~ValidBuckets() {
+        delete [] head;
+        delete [] tail;
+        delete [] bucket_size;
+        delete [] prev;
+        delete [] next;
+        delete [] bucket_of;
+    }
+
+    /* add a block to the end of bucket 'valid' */
+    void insert(int block, int valid){
+        assert(bucket_of[block] == NO_BLOCK);
+        assert(valid >= 0 && valid <= max_valid);
+        prev[block] = tail[valid];
+        next[block] = NO_BLOCK;
+        if (tail[valid] == NO_BLOCK){
+            head[valid] = block;
+        }
+        else {
+            next[tail[valid]] = block;
+        }
+        tail[valid] = block;
+        bucket_of[block] = valid;
+        bucket_size[valid]++;
+        if (valid < min_valid){
+            min_valid = valid;
+        }
+    }
+
+    /* remove a block from the bucket it is in */
+    void erase(int block){
+        int valid = bucket_of[block];
+        assert(valid != NO_BLOCK);
+        if (prev[block] == NO_BLOCK){
+            head[valid] = next[block];
+        }
+        else {
+            next[prev[block]] = next[block];
+        }
+        if (next[block] == NO_BLOCK){
+            tail[valid] = prev[block];
+        }
+        else {
+            prev[next[block]] = prev[block];
+        }
+        prev[block] = NO_BLOCK;
+        next[block] = NO_BLOCK;
+        bucket_of[block] = NO_BLOCK;
+        bucket_size[valid]--;
+    }
+
+    /* move a block to bucket 'valid' */
+    void move(int block, int valid){
+        erase(block);
+        insert(block, valid);
+    }
+
+    bool contains(int block) const{
+        return bucket_of[block] != NO_BLOCK;
+    }
+
+    int size(int valid) const{
+        return bucket_size[valid];
+    }
+
+    bool empty(int valid) const{
+        return bucket_size[valid] == 0;
+    }
+
+    /* first block of a bucket, NO_BLOCK if the bucket is empty */
+    int front(int valid) const{
+        return head[valid];
+    }
+
+    /* the lowest non empty bucket, or max_valid+1 if there are no blocks in any bucket */
+    int minValid(){
+        while (min_valid <= max_valid && bucket_size[min_valid] == 0){
+            min_valid++;
+        }
+        return min_valid;
+    }
+
+    /* iteration over the blocks of a single bucket: for (int block : buckets.bucket(i)) {...} */
+    class Iterator{
+    public:
+        const int* next;
+        int block;
+        Iterator(const int* next, int block) : next(next), block(block) {}
+        int operator*() const { return block; }
+        Iterator& operator++() { block = next[block]; return *this; }
+        bool operator!=(const Iterator& other) const { return block != other.block; }
+    };
+
+    class Bucket{
+    public:
+        const int* next;
+        int first;
+        Bucket(const int* next, int first) : next(next), first(first) {}
+        Iterator begin() const { return Iterator(next, first); }
+        Iterator end() const { return Iterator(next, NO_BLOCK); }
+    };
+
+    Bucket bucket(int valid) const{
+        assert(valid >= 0 && valid <= max_valid);
+        return Bucket(next, head[valid]);
+    }
+};
+
+#endif //FLASHGC_VALIDBUCKETS_H
@@ -0,0 +1,147 @@
+/*
+ *	Created by Eyal Lotan and Dor Sura.
+ */
+
+/*
+ *	Benchmark for the V data structure of the FTL: the linked ValidBuckets against the previous implementation
+ *	(an array of std::set<int> scanned linearly for the minimum).
+ *	Both structures are driven by the same simplified greedy FTL: every host write obsoletes a random page of a
+ *	full block (moving that block one bucket down), and when the open block fills up it is inserted into V and
+ *	the block with the minimum number of valid pages is taken out as the next open block.
+ *
+ *	USAGE: ./ValidBucketsBenchmark [number of writes]
+ */
+
+#include <iostream>
+#include <chrono>
+#include <random>
+#include <set>
+#include <vector>
+#include <cstdlib>
+#include "ValidBuckets.h"
+
+using namespace std;
+
+/* the V implementation FTL used before ValidBuckets */
+class SetBuckets{
+public:
+    int max_valid;
+    set<int>* V;
+
+    SetBuckets(int number_of_blocks, int max_valid) : max_valid(max_valid), V(new set<int>[max_valid + 1]) {}
+
+    ~SetBuckets() {
+        delete [] V;
+    }
+
+    void insert(int block, int valid){
+        V[valid].insert(block);
+    }
+
+    void erase(int block, int valid){
+        V[valid].erase(block);
+    }
+
+    void move(int block, int from, int to){
+        V[from].erase(block);
+        V[to].insert(block);
+    }
+
+    int popMin(int* valid){
+        int min_valid = 0;
+        while (min_valid <= max_valid && V[min_valid].empty()) {
+            min_valid++;
+        }
+        *valid = min_valid;
+        int block = *(V[min_valid].begin());
+        V[min_valid].erase(block);
+        return block;
+    }
+};
+
+class LinkedBuckets{
+public:
+    ValidBuckets V;
+
+    LinkedBuckets(int number_of_blocks, int max_valid) : V(number_of_blocks, max_valid) {}
+
+    void insert(int block, int valid){
+        V.insert(block, valid);
+    }
+
+    void erase(int block, int valid){
+        V.erase(block);
+    }
+
+    void move(int block, int from, int to){
+        V.move(block, to);
+    }
+
+    int popMin(int* valid){
+        *valid = V.minValid();
+        int block = V.front(*valid);
+        V.erase(block);
+        return block;
+    }
+};
+
+/* run the simplified greedy FTL over 'writes' host writes and return the average time per write in ns */
+template <class Buckets>
+double runBenchmark(int physical_blocks, int logical_blocks, int pages_per_block, unsigned long long writes){
+    Buckets buckets(physical_blocks, pages_per_block);
+    vector<int> valid(physical_blocks, 0);
+    std::mt19937 generator(12345);
+
+    /* start in steady state: the logical pages are spread evenly over all blocks but one (the open block) */
+    int logical_pages = logical_blocks * pages_per_block;
+    for (int i = 0; i < physical_blocks - 1; i++) {
+        valid[i] = logical_pages / (physical_blocks - 1) + (i < logical_pages % (physical_blocks - 1) ? 1 : 0);
+        buckets.insert(i, valid[i]);
+    }
+    int open_block = physical_blocks - 1;
+    int next_free = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned long long i = 0; i < writes; i++) {
+        /* obsolete a uniformly chosen valid page of a full block (rejection sampling keeps the number of
+         * valid pages in the device constant, as in the real FTL)
+         */
+        while (true) {
+            int block = generator() % physical_blocks;
+            if (block != open_block && (int)(generator() % pages_per_block) < valid[block]){
+                buckets.move(block, valid[block], valid[block] - 1);
+                valid[block]--;
+                break;
+            }
+        }
+
+        /* write to the open block and collect a new one when it is full */
+        next_free++;
+        valid[open_block]++;
+        if (next_free == pages_per_block){
+            buckets.insert(open_block, valid[open_block]);
+            int victim_valid;
+            open_block = buckets.popMin(&victim_valid);
+            valid[open_block] = victim_valid;
+            next_free = victim_valid;
+        }
+    }
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() / writes;
+}
+
+int main(int argc, char** argv) {
+    unsigned long long writes = argc > 1 ? atoll(argv[1]) : 20000000;
+
+    /* (T, U, Z) */
+    int geometries[][3] = {{64, 50, 32}, {256, 200, 64}, {1024, 800, 256}, {1024, 900, 512}};
+
+    cout << "T\tU\tZ\tstd::set ns/write\tValidBuckets ns/write\tspeedup" << endl;
+    for (auto& geometry : geometries) {
+        double set_ns = runBenchmark<SetBuckets>(geometry[0], geometry[1], geometry[2], writes);
+        double linked_ns = runBenchmark<LinkedBuckets>(geometry[0], geometry[1], geometry[2], writes);
+        cout << geometry[0] << "\t" << geometry[1] << "\t" << geometry[2] << "\t" << set_ns << "\t\t\t"
+             << linked_ns << "\t\t\t" << set_ns / linked_ns << "x" << endl;
+    }
+    return 0;
+}
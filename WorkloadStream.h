@@ -0,0 +1,155 @@
+/*
+ *	Created by Eyal Lotan and Dor Sura.
+ */
+
+/*
+ *	WorkloadStream is a bounded-memory view of the writing sequence. A generator thread pulls chunks of the
+ *	sequence from a WritingSequenceSource into a ring buffer, while the simulation consumes it. The consumer may
+ *	read any position from the oldest position it did not release yet up to 'window' positions ahead, so the
+ *	lookahead algorithms see exactly the future they need and memory stays O(window) instead of O(N).
+ *	Generation runs one chunk ahead of the simulation and overlaps with the FTL work.
+ *	A stream can also be built directly over a sequence that is already in memory (e.g a memory mapped trace). In
+ *	that case there is no generator thread and no copy: the stream reads the given array.
+ */
+
+#ifndef FLASHGC_WORKLOADSTREAM_H
+#define FLASHGC_WORKLOADSTREAM_H
+
+#include <atomic>
+#include <cassert>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include "MyRand.h"
+#include "Profiler.h"
+
+/* number of sequence positions generated in one go by the generator thread */
+#define WORKLOAD_CHUNK_SIZE (1ULL << 16)
+
+class WorkloadStream{
+public:
+    /* the generator of the sequence. owned by the stream */
+    WritingSequenceSource* source;
+
+    /* length of the writing sequence */
+    unsigned long long number_of_pages;
+
+    /* how many positions ahead of the oldest unreleased position the consumer may read */
+    unsigned long long window;
+
+    /* ring buffer of capacity positions. position i is stored in ring[i % capacity] */
+    unsigned long long capacity;
+    const unsigned int* ring;
+
+    /* the storage of the ring when it is filled by the generator thread, nullptr for a stream over an array */
+    unsigned int* buffer;
+
+    /* positions [0, produced) were generated. written by the generator thread only */
+    std::atomic<unsigned long long> produced;
+
+    /* positions [0, released) are no longer needed and may be overwritten. written by the consumer only */
+    std::atomic<unsigned long long> released;
+
+    /* consumer side copy of 'produced', saves an atomic load per read */
+    unsigned long long known_produced;
+
+    /* the chunk 'released' was in when the generator was last notified */
+    unsigned long long released_chunk;
+
+    bool stop;
+    std::mutex mutex;
+    std::condition_variable data_ready;
+    std::condition_variable space_ready;
+    std::thread generator;
+
+    WorkloadStream(WritingSequenceSource* source, unsigned long long number_of_pages, unsigned long long window) :
+                   source(source), number_of_pages(number_of_pages), window(window),
+                   capacity(((window + WORKLOAD_CHUNK_SIZE - 1) / WORKLOAD_CHUNK_SIZE + 2) * WORKLOAD_CHUNK_SIZE),
+                   buffer(new unsigned int[capacity]), produced(0), released(0), known_produced(0),
+                   released_chunk(0), stop(false) {
+        ring = buffer;
+        generator = std::thread(&WorkloadStream::generateLoop, this);
+    }
+
+    /* a stream over a sequence of number_of_pages positions that is already in memory. the sequence is not
+     * copied and must outlive the stream.
+     */
+    WorkloadStream(const unsigned int* sequence, unsigned long long number_of_pages) :
+                   source(nullptr), number_of_pages(number_of_pages), window(number_of_pages),
+                   capacity(number_of_pages), ring(sequence), buffer(nullptr), produced(number_of_pages), released(0),
+                   known_produced(number_of_pages), released_chunk(0), stop(false) {}
+
+    ~WorkloadStream() {
+        if (generator.joinable()){
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stop = true;
+            }
+            space_ready.notify_all();
+            generator.join();
+        }
+        delete [] buffer;
+        delete source;
+    }
+
+    /* get the logical page written at position page_index of the sequence */
+    unsigned int at(unsigned long long page_index){
+        assert(page_index < number_of_pages);
+        assert(page_index >= released.load(std::memory_order_relaxed));
+        assert(page_index < released.load(std::memory_order_relaxed) + capacity);
+        if (page_index >= known_produced){
+            waitFor(page_index);
+        }
+        return ring[page_index % capacity];
+    }
+
+    /* declare that positions before page_index will not be read again */
+    void release(unsigned long long page_index){
+        released.store(page_index, std::memory_order_release);
+        if (page_index / WORKLOAD_CHUNK_SIZE != released_chunk){
+            released_chunk = page_index / WORKLOAD_CHUNK_SIZE;
+            std::lock_guard<std::mutex> lock(mutex);
+            space_ready.notify_one();
+        }
+    }
+
+private:
+    void waitFor(unsigned long long page_index){
+        std::unique_lock<std::mutex> lock(mutex);
+        data_ready.wait(lock, [this, page_index] {
+            return produced.load(std::memory_order_acquire) > page_index;
+        });
+        known_produced = produced.load(std::memory_order_acquire);
+    }
+
+    /* generator thread: fill the ring chunk by chunk, staying at most 'capacity' positions ahead of the consumer.
+     * chunks are aligned to WORKLOAD_CHUNK_SIZE and capacity is a multiple of it, so a chunk never wraps.
+     */
+    void generateLoop(){
+        unsigned long long next = 0;
+        while (next < number_of_pages) {
+            unsigned long long count = std::min(WORKLOAD_CHUNK_SIZE, number_of_pages - next);
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                space_ready.wait(lock, [this, next, count] {
+                    return stop || next + count <= released.load(std::memory_order_acquire) + capacity;
+                });
+                if (stop){
+                    return;
+                }
+            }
+            {
+                PROFILE_SCOPE(PROFILE_SEQUENCE_GENERATION);
+                source->generate(buffer + next % capacity, count);
+            }
+            next += count;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                produced.store(next, std::memory_order_release);
+            }
+            data_ready.notify_one();
+        }
+    }
+};
+
+#endif //FLASHGC_WORKLOADSTREAM_H
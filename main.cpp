@@ -2,18 +2,26 @@
 #include <fstream>
 #include <cstdlib>
 #include "AlgoRunner.h"
+#include "SweepRunner.h"
+#include "ReplicaRunner.h"
 using namespace std;
 
 /* get parameters from command line
- * #1:PHYSICAL_BLOCK_NUMBER
- * #2:LOGICAL_BLOCK_NUMBER
- * #3:PAGES_PER_BLOCK
- * #4:PAGE_SIZE
- * #5:NUMBER_OF_PAGES
+ * #1:physical blocks (T)
+ * #2:logical blocks (U)
+ * #3:pages per block (Z)
+ * #4:page size
+ * #5:number of pages (N)
  * #6:WINDOW_FLAG
  * #7:DATA_DISTRIBUTION
  * #8:ALGORITHM
  * #9:optional parameter - filename to redirect output to
+ * optional flags (anywhere after #8):
+ * --save-snapshot=<path> - save the steady state FTL to a snapshot file
+ * --load-snapshot=<path> - start from a saved steady state instead of running the warmup
+ * --series=<path> - record the erases, logical writes, Y and V over the run (see TimeSeriesRecorder.h)
+ * or: sweep <key=values>... to run a grid of simulations (see SweepRunner.h)
+ * or: convert <input> <output> [options] to convert a text trace to a binary trace (see TraceFile.h)
  */
 
 /**
@@ -32,8 +40,32 @@ void printHelp()
             "7. Data distribution.\n"
             "8. GC algorithm.\n"
             "9. Optional parameter: Filename to redirect output to." << endl;
+    cout << "Optional flags, after the GC algorithm:\n"
+            "--save-snapshot=<path> saves the steady state FTL to a snapshot file.\n"
+            "--load-snapshot=<path> loads the steady state from a snapshot (same T, U, Z) instead of running the warmup.\n"
+            "--warmup=<writes> runs a fixed number of warmup writes. By default the warmup runs until the write\n"
+            "amplification and the valid pages histogram settle.\n"
+            "--ci-target=<fraction> stops the measurement once the 95% confidence interval of the write amplification\n"
+            "is within +-fraction of its mean (e.g 0.01). N is then an upper bound on the measured writes.\n"
+            "--seed=<value> seeds the simulation (by default the seed is taken from the clock and printed).\n"
+            "--replicas=<R> runs R independent replicas (seeds seed..seed+R-1) in parallel and prints the mean,\n"
+            "standard deviation and percentiles of the erases and the write amplification.\n"
+            "--threads=<count> number of threads for the replicas and the sequence generation (default: number of cores).\n"
+            "--rng=<kiss|philox> generator of the writing sequence. philox is a counter based generator: the sequence is\n"
+            "generated on all the threads and is identical for a given seed whatever the number of threads is.\n"
+            "--series=<path> records the erases, logical writes, Y and the V histogram over the run (warmup included)\n"
+            "to a .csv file, or to a compact binary file for any other extension.\n"
+            "--series-interval=<erases> records one sample every given number of erases (default: every erase).\n"
+            "--candidate-depth=<k> greedy_lookahead scores the blocks with Y..Y+k valid pages instead of only the\n"
+            "blocks with the fewest (Y) valid pages (default: 0, at most 4). a depth of 2-4 usually lowers the WA,\n"
+            "deeper searches relocate more valid pages and can increase it, so they are not allowed.\n"
+            "--candidate-blocks=<M> scores at most M blocks, from the fewest valid pages up (default: 0, no limit).\n"
+            "--score-threads=<count> scores large candidate sets on count threads (default: 1)." << endl;
     cout << "For data distribution parameter choose between uniform or hot_cold. If you choose hot/cold distribution, " << endl
-         << "you will be asked to choose the hot page percentage and the probability for a hot page." << endl;
+         << "you will be asked to choose the hot page percentage and the probability for a hot page." << endl
+         << "To replay a binary trace file use trace=<path>. The first N writes of the trace are replayed (N=0 replays " << endl
+         << "the whole trace). Convert text traces (MSR/SNIA csv, \"op,offset,size\" or one LPN per line) with:" << endl
+         << "./Simulator convert <input> <output> [page_size=<bytes>] [--compact] [--with-ops]" << endl;
     cout << "For window flag choose between window_on or window_off. If you choose window_on you will be asked to " << endl
          << "choose the window size. Window size should be between 0 and N." << endl;
     cout << "For GC algorithm choose between the following:\n"
@@ -42,10 +74,32 @@ void printHelp()
             "3. generational. If you choose this option you will be prompt to choose the number of generations. " << endl
             << "Make sure that the number of generations is between 1 and T-U (this will be enforced by the simulator)." << endl
             << "If you choose number of generations to be 0, the simulator will choose the number of generations using " << endl
-            << "a heurisitc function." << endl;
+            << "a heurisitc function." << endl
+            << "4. oracle. Picks the victim by the future writes: the block with the fewest valid pages plus valid " << endl
+            << "pages that are overwritten within (T-U)*Z/2 writes, kept in a heap that is updated on every write." << endl
+            << "To compare algorithms on the same writing sequence, give a comma separated list (e.g " << endl
+            << "greedy,greedy_lookahead,generational): the FTL is forked at the steady state and all the algorithms " << endl
+            << "run in lockstep. writing_assignment can not run in lockstep." << endl;
+    cout << "Sweep mode runs a grid of simulations on all cores and prints one table of results:\n"
+            "./Simulator sweep T=64,128 U=50,52 Z=32 N=100000 algo=greedy,greedy_lookahead dist=uniform\n"
+            "Every parameter takes a comma separated list of values and all combinations are simulated.\n"
+            "Optional parameters: page_size (4096), hot_percentage (10), hot_probability (0.9), window (0 = off),\n"
+            "generations (0 = heuristic), seed (1), rng (kiss), warmup (0 = until steady state), ci_target (0 = measure all N),\n"
+            "candidate_depth (0, at most 4), candidate_blocks (0 = no limit), threads (number of cores).\n"
+            "spec=<file> reads the parameters from an experiment spec file (one key=values per line, # comments).\n"
+            "cache=<directory> keeps the result of every simulation there, and the simulations whose result is already\n"
+            "cached are not run again." << endl;
 }
 
 int main(int argc, char** argv) {
+	PROFILE_START();
+	if (argc >= 2 && strcmp("sweep", argv[1]) == 0) {
+		return runSweep(argc - 2, argv + 2);
+	}
+	if (argc >= 2 && strcmp("convert", argv[1]) == 0) {
+		return runTraceConversion(argc - 2, argv + 2);
+	}
+
 	if (argc < 9) {
 	    if (argc == 2 && strcmp("--help", argv[1]) == 0){
 	        printHelp();
@@ -57,16 +111,96 @@ int main(int argc, char** argv) {
 		return -1;
 	}
 
-	if (argc == 10) {
-		output_file = argv[9];
+	/* the optional flags. the rest of the user parameters is read from the user by the AlgoRunner c'tor */
+	UserParameters user_parameters = UserParameters();
+	/* without an explicit seed the run is seeded from the clock. the seed is printed, so any run can be repeated */
+	unsigned long long seed = time(nullptr);
+	int replicas = 1;
+	int threads = ThreadPool::defaultSize();
+	for (int i = 9; i < argc; i++) {
+		if (strncmp(argv[i], "--save-snapshot=", 16) == 0) {
+			user_parameters.save_snapshot = argv[i] + 16;
+		}
+		else if (strncmp(argv[i], "--load-snapshot=", 16) == 0) {
+			user_parameters.load_snapshot = argv[i] + 16;
+		}
+		else if (strncmp(argv[i], "--warmup=", 9) == 0) {
+			user_parameters.warmup_writes = strtoull(argv[i] + 9, nullptr, 10);
+		}
+		else if (strncmp(argv[i], "--ci-target=", 12) == 0) {
+			user_parameters.ci_target = atof(argv[i] + 12);
+			if (user_parameters.ci_target <= 0 || user_parameters.ci_target >= 1) {
+				cerr << "Error! the CI target must be in the (0,1) range." << endl;
+				return -1;
+			}
+		}
+		else if (strncmp(argv[i], "--rng=", 6) == 0) {
+			user_parameters.sequence_generator = generatorStringToEnum(argv[i] + 6);
+			if (user_parameters.sequence_generator == INVALID_GENERATOR) {
+				cerr << "Invalid random number generator: " << argv[i] + 6 << endl;
+				printHelp();
+				return -1;
+			}
+		}
+		else if (strncmp(argv[i], "--series=", 9) == 0) {
+			user_parameters.series_path = argv[i] + 9;
+		}
+		else if (strncmp(argv[i], "--series-interval=", 18) == 0) {
+			user_parameters.series_interval = strtoull(argv[i] + 18, nullptr, 10);
+		}
+		else if (strncmp(argv[i], "--candidate-depth=", 18) == 0) {
+			user_parameters.candidate_depth = atoi(argv[i] + 18);
+			if (user_parameters.candidate_depth < 0 || user_parameters.candidate_depth > MAX_CANDIDATE_DEPTH) {
+				cerr << "Error! the candidate depth must be in 0-" << MAX_CANDIDATE_DEPTH << " range." << endl;
+				return -1;
+			}
+		}
+		else if (strncmp(argv[i], "--candidate-blocks=", 19) == 0) {
+			user_parameters.candidate_blocks = atoi(argv[i] + 19);
+			if (user_parameters.candidate_blocks < 0) {
+				cerr << "Error! the number of candidate blocks can not be negative." << endl;
+				return -1;
+			}
+		}
+		else if (strncmp(argv[i], "--score-threads=", 16) == 0) {
+			user_parameters.score_threads = atoi(argv[i] + 16);
+			if (user_parameters.score_threads < 1) {
+				cerr << "Error! the number of score threads must be positive." << endl;
+				return -1;
+			}
+		}
+		else if (strncmp(argv[i], "--seed=", 7) == 0) {
+			seed = strtoull(argv[i] + 7, nullptr, 10);
+		}
+		else if (strncmp(argv[i], "--replicas=", 11) == 0) {
+			replicas = atoi(argv[i] + 11);
+			if (replicas < 1) {
+				cerr << "Error! the number of replicas must be positive." << endl;
+				return -1;
+			}
+		}
+		else if (strncmp(argv[i], "--threads=", 10) == 0) {
+			threads = atoi(argv[i] + 10);
+			if (threads < 1) {
+				cerr << "Error! the number of threads must be positive." << endl;
+				return -1;
+			}
+		}
+		else if (strncmp(argv[i], "--", 2) == 0 || output_file) {
+			cerr << "Invalid parameter: " << argv[i] << endl;
+			printHelp();
+			return -1;
+		}
+		else {
+			output_file = argv[i];
+		}
+	}
+	bool redirect_output = output_file != nullptr;
+	if (redirect_output) {
 		freopen(output_file, "a", stdout);
 	}
 
-	PHYSICAL_BLOCK_NUMBER = atoi(argv[1]);
-	LOGICAL_BLOCK_NUMBER = atoi(argv[2]);
-	PAGES_PER_BLOCK = atoi(argv[3]);
-	PAGE_SIZE = atoi(argv[4]);
-	NUMBER_OF_PAGES = atoll(argv[5]);
+	Geometry geometry(atoi(argv[1]), atoi(argv[2]), atoi(argv[3]), atoi(argv[4]), atoll(argv[5]));
 	WindowSizeFlag window_size_flag = windowSizeFlagToEnum(argv[6]);
 	if (window_size_flag == INVALID_WINDOW_SIZE_FLAG){
 		cerr << "Invalid Window Size Flag Parameter!" << endl;
@@ -79,48 +213,70 @@ int main(int argc, char** argv) {
         printHelp();
         return -1;
 	}
-	Algorithm algo = algoStringToEnum(argv[8]);
-	if (algo == INVALID_ALGO){
+	/* several comma separated algorithms run in lockstep on the same writing sequence */
+	vector<Algorithm> lockstep_algorithms = algoListStringToEnum(argv[8]);
+	bool lockstep = lockstep_algorithms.size() > 1;
+	Algorithm algo = lockstep ? AlgoRunner::lockstepAlgorithm(lockstep_algorithms) : algoStringToEnum(argv[8]);
+	if (algo == INVALID_ALGO || (lockstep && find(lockstep_algorithms.begin(), lockstep_algorithms.end(),
+	                                               WRITING_ASSIGNMENT) != lockstep_algorithms.end())){
         cerr << "Invalid Algorithm Parameter!" << endl;
         printHelp();
         return -1;
 	}
 
-	float ALPHA = (float) LOGICAL_BLOCK_NUMBER / PHYSICAL_BLOCK_NUMBER;
     cout << "Starting GC Simulator!" << endl;
-	cout << "Physical Blocks:\t" << PHYSICAL_BLOCK_NUMBER << endl;
-	cout << "Logical Blocks:\t\t" << LOGICAL_BLOCK_NUMBER << endl;
-	cout << "Pages/Block:\t\t" << PAGES_PER_BLOCK << endl;
-	cout << "Page Size:\t\t" << PAGE_SIZE << endl;
-	cout << "Alpha:\t\t\t" << ALPHA << endl;
-	cout << "Over Provisioning:\t"<< (float)(PHYSICAL_BLOCK_NUMBER-LOGICAL_BLOCK_NUMBER)/LOGICAL_BLOCK_NUMBER<<endl;
-    cout << "Number of Pages:\t" << NUMBER_OF_PAGES << endl;
+	cout << "Physical Blocks:\t" << geometry.physical_blocks << endl;
+	cout << "Logical Blocks:\t\t" << geometry.logical_blocks << endl;
+	cout << "Pages/Block:\t\t" << geometry.pages_per_block << endl;
+	cout << "Page Size:\t\t" << geometry.page_size << endl;
+	cout << "Alpha:\t\t\t" << geometry.alpha() << endl;
+	cout << "Over Provisioning:\t"<< geometry.overProvisioning() <<endl;
+    cout << "Number of Pages:\t" << geometry.number_of_pages << endl;
     cout << "Page Distribution:\t" << argv[7] << endl;
     cout << "GC Algorithm:\t\t" << argv[8] << endl;
+    cout << "Seed:\t\t\t" << seed << " (" << generatorEnumToString(user_parameters.sequence_generator) << ")" << endl;
+    if (replicas > 1) {
+        cout << "Replicas:\t\t" << replicas << " (seeds " << seed << "-" << seed + replicas - 1 << ")" << endl;
+    }
     cout << endl;
 
-
-
-    /* activate random number generator seed */
-	seed();
+    if (page_dist == TRACE) {
+        user_parameters.trace_path = argv[7] + strlen("trace=");
+    }
+    /* the threads are shared by the replicas first, whatever is left generates the writing sequence of each one */
+    user_parameters.generation_threads = max(threads / replicas, 1);
 
 	/* generate scheduledGC object */
-    AlgoRunner* scg = new AlgoRunner(NUMBER_OF_PAGES, page_dist, algo, window_size_flag);
-
-    /* if you wish to activate print mode remove comment */
-    //scg->setPrintMode(true);
+    AlgoRunner* scg = new AlgoRunner(geometry, page_dist, algo, window_size_flag, user_parameters, seed);
 
     /* if you wish to deactivate steady state mode remove comment */
     //scg->setSteadyState(false);
 
-    /* run simulation and print results */
-    scg->runSimulation(algo);
-    scg->printSimulationResults();
+    if (replicas > 1) {
+        /* the replicas run concurrently, so none of them prints its progress */
+        scg->verbose = false;
+        ReplicaRunner replica_runner(scg, lockstep ? lockstep_algorithms : vector<Algorithm>(1, algo), replicas, threads);
+        cout << "Running " << replicas << " replicas on " << min(replicas, threads) << " threads..." << endl;
+        replica_runner.run();
+        replica_runner.printResults();
+    }
+    else {
+        /* run simulation and print results */
+        if (lockstep) {
+            scg->runLockstepSimulation(lockstep_algorithms);
+        }
+        else {
+            scg->runSimulation(algo);
+        }
+        scg->printSimulationResults();
+    }
 
     /* cleanup */
     delete scg;
+    /* the worker and generator threads are done, so the profile is complete */
+    PROFILE_DUMP();
     output_file = nullptr;
-	if (argc == 10){
+	if (redirect_output){
 		fclose(stdout);
 	}
 